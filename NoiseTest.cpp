@@ -15,25 +15,17 @@ class ValueNoise
   public:
     static const size_t size = 256;
     static const unsigned mask = 0xFF;
+    static const uint32_t seed = 90837492;
 
-    ValueNoise(unsigned seed=100);
     double Lattice(unsigned x, unsigned y);
     double noise(double u, double v);
 
   private:
-    typedef ComplimentaryMultiplyWithCarry CMWC;
-    ComplimentaryMultiplyWithCarry cmwc { 90837492 };
-
-    Array<unsigned> lattice { size };
-    Array<double> valueTable { from(0).to(size), [&](int){ return RandomDouble()(cmwc); } };
+    // Fixed-seed tables, generated at compile time.
+    static constexpr std::array<uint32_t, size> lattice = permutationTable<size>(MinstdEngine(seed));
+    static constexpr std::array<double, size> valueTable = uniformTable<size>(XorShift0Engine(seed));
 };
 
-ValueNoise::ValueNoise(unsigned seed) 
-{
-  FisherYatesShuffler<CMWC> shuffle { cmwc };
-  shuffle(from(0).to(lattice.size()), lattice.range());
-}
-
 double ValueNoise::Lattice(unsigned x, unsigned y) 
 {
    return valueTable[ lattice[ (x + lattice[y&mask]) & mask ] ];
@@ -109,7 +101,6 @@ class NoiseWindow : public SimpleDrawWindow
 NoiseWindow::NoiseWindow() 
    : 
       SimpleDrawWindow(600, 600, BlackOpaque), 
-      value(200),
       fractal(2, 1.5, 4, &value)
 {
 }
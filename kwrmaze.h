@@ -0,0 +1,873 @@
+#ifndef KWR_HEADER_KWRMAZE_H
+#define KWR_HEADER_KWRMAZE_H
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <algorithm>
+#include "kwrlib.h"
+#include "kwrerr.h"
+#include "kwrprng.h"
+#include "kwrthread.h"
+
+namespace kwr {
+
+// Maze grids and generators, without SDL.  Both grids number cells
+// row-major, index = row*columns + column, and share one interface:
+//   size(), neighbor(index, direction), open(index, direction), link(index, direction),
+//   passages(index), a mask with bit d set when direction d is open,
+// so generators, solvers and MazeWindow are templates over the grid.
+
+const int North = 0;
+const int East  = 1;
+const int West  = 2;
+const int South = 3;
+
+inline int opposite(int direction) { return 3 - direction; }
+
+class Cell;
+
+class CellLink {
+  public:
+    Cell* link = nullptr;
+    bool  open = false;
+};
+
+class Cell
+{
+  public:
+    void init(int r, int c) { row = r; column = c; }
+
+    void link(Cell* cell, bool bidi = true)
+    {
+        if (!cell) return;
+        for (int i = 0; i < 4; ++i) {
+            if (links[i].link == cell) {
+                links[i].open = true;
+                break;
+            }
+        }
+        if (bidi) cell->link(this, false);
+    }
+
+    int row, column;
+    CellLink links[4];
+};
+
+class MazeGrid {
+  public:
+    MazeGrid(int rs, int cs) :
+      rows(rs), columns(cs), cells(rows*columns)
+    {
+        prepare();
+        configure();
+    }
+
+    void prepare()
+    {
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < columns; ++c) {
+                get(r, c)->init(r, c);
+            }
+        }
+    }
+
+    void configure()
+    {
+        for (int i = 0; i < cells.size(); ++i) {
+            Cell& cell = cells[i];
+            cell.links[North].link = get(cell.row-1, cell.column);
+            cell.links[South].link = get(cell.row+1, cell.column);
+            cell.links[West].link  = get(cell.row,   cell.column-1);
+            cell.links[East].link  = get(cell.row,   cell.column+1);
+        }
+    }
+
+    Cell* get(int r, int c)
+    {
+        if (r < 0 || r >= rows) return nullptr;
+        if (c < 0 || c >= columns) return nullptr;
+        return &cells[r*columns + c];
+    }
+
+    int size() const { return cells.size(); }
+
+    // Index of the cell beyond the wall, -1 at the boundary.
+    int neighbor(int i, int direction) const
+    {
+        const Cell* cell = cells[i].links[direction].link;
+        return cell? cell - &cells[0]: -1;
+    }
+
+    bool open(int i, int direction) const { return cells[i].links[direction].open; }
+    void link(int i, int direction) { cells[i].link(cells[i].links[direction].link); }
+
+    unsigned passages(int i) const
+    {
+        unsigned mask = 0;
+        for (int d = 0; d < 4; ++d) mask |= unsigned(open(i, d)) << d;
+        return mask;
+    }
+
+    int rows, columns;
+    Array<Cell> cells;
+};
+
+// Two bits per cell: one plane of north passages and one of east passages,
+// each row padded to whole 64-bit words.  South and west are the north and
+// east bits of the neighbour, and neighbours are index arithmetic.  A row's
+// words hold only that row's north and east walls, so row-at-a-time
+// generators can carve different rows on different threads.
+class CompactMazeGrid {
+  public:
+    CompactMazeGrid(int rs, int cs) :
+      rows(rs), columns(cs), stride((cs + 63) / 64),
+      north(rows*stride), east(rows*stride)
+    {
+        std::memset(&north[0], 0, sizeof(uint64_t) * north.size());
+        std::memset(&east[0],  0, sizeof(uint64_t) * east.size());
+    }
+
+    int size() const { return rows*columns; }
+
+    int neighbor(int i, int direction) const
+    {
+        int column = i % columns;
+        switch (direction) {
+          case North: return i >= columns? i - columns: -1;
+          case South: return i + columns < size()? i + columns: -1;
+          case West:  return column > 0? i - 1: -1;
+          default:    return column < columns-1? i + 1: -1;
+        }
+    }
+
+    bool open(int i, int direction) const
+    {
+        int row = i / columns, column = i - row*columns;
+        switch (direction) {
+          case North: return bit(north, row, column);
+          case East:  return bit(east, row, column);
+          case South: return row < rows-1 && bit(north, row+1, column);
+          default:    return column > 0 && bit(east, row, column-1);
+        }
+    }
+
+    unsigned passages(int i) const
+    {
+        int row = i / columns, column = i - row*columns;
+        return unsigned(bit(north, row, column)) << North
+             | unsigned(bit(east, row, column)) << East
+             | unsigned(column > 0 && bit(east, row, column-1)) << West
+             | unsigned(row < rows-1 && bit(north, row+1, column)) << South;
+    }
+
+    // Opens the wall between cell i and its neighbour; nothing at the boundary.
+    void link(int i, int direction)
+    {
+        int row = i / columns, column = i - row*columns;
+        switch (direction) {
+          case North: if (row > 0) set(north, row, column); break;
+          case East:  if (column < columns-1) set(east, row, column); break;
+          case South: if (row < rows-1) set(north, row+1, column); break;
+          default:    if (column > 0) set(east, row, column-1); break;
+        }
+    }
+
+    // Row r's passages, bit c of word c/64, for generators that carve whole
+    // words at a time.
+    uint64_t* northRow(int r) { return &north[r*stride]; }
+    uint64_t* eastRow(int r)  { return &east[r*stride]; }
+
+    int rows, columns, stride;
+
+  private:
+    bool bit(const Array<uint64_t>& plane, int r, int c) const
+    {
+        return plane[r*stride + c/64] >> (c % 64) & 1;
+    }
+
+    void set(Array<uint64_t>& plane, int r, int c)
+    {
+        plane[r*stride + c/64] |= uint64_t(1) << (c % 64);
+    }
+
+    Array<uint64_t> north, east;
+};
+
+// Binary tree: each cell opens north or east at random, or the only one of
+// the two it has.
+template <typename Grid>
+void BinaryTreeMaze(Grid& maze, uint32_t seed)
+{
+    ComplimentaryMultiplyWithCarry cmwc(seed);
+    RandomBounded coin(2);
+
+    for (int i = 0; i < maze.size(); ++i) {
+        int neighbors[2] = { North, East };
+        bool has_north = maze.neighbor(i, North) >= 0;
+        bool has_east  = maze.neighbor(i, East) >= 0;
+
+        if (has_north && has_east) maze.link(i, neighbors[coin(cmwc)]);
+        else if (has_north)        maze.link(i, North);
+        else if (has_east)         maze.link(i, East);
+    }
+}
+
+// Sidewinder: runs of cells joined eastward, each closed by opening north
+// from one random member of the run.
+template <typename Grid>
+void SidewinderMaze(Grid& maze, uint32_t seed)
+{
+    ComplimentaryMultiplyWithCarry cmwc(seed);
+    RandomBounded coin(2);
+    Array<int> run(maze.columns);
+
+    for (int row = 0; row < maze.rows; ++row) {
+        int runlen = 0;
+        for (int col = 0; col < maze.columns; ++col) {
+            int cell = row*maze.columns + col;
+            run[runlen++] = cell;
+
+            bool at_eastern_boundary = col == maze.columns-1;
+            bool at_northern_boundary = row == 0;
+
+            bool heads = coin(cmwc);
+            bool close_out = at_eastern_boundary || (!at_northern_boundary && heads);
+
+            if (close_out) {
+                int member = run[RandomBounded::bounded(cmwc, runlen)];
+                maze.link(member, North);
+                runlen = 0;
+            }
+            else {
+                maze.link(cell, East);
+            }
+        }
+    }
+}
+
+// Calls row(r) for every row, in bands spread over the pool.  Generators
+// that draw each row from its own stream, Pcg32(seed, row), then give the
+// same maze for any number of threads.
+template <typename Function>
+void forEachRow(int rows, ThreadPool& pool, const Function& row)
+{
+    int bands = std::min(rows, 8 * pool.size());
+    pool.run(bands, [&](int band) {
+        int end = (int64_t)(band + 1) * rows / bands;
+        for (int r = (int64_t)band * rows / bands; r < end; ++r)
+            row(r);
+    });
+}
+
+// Bits for columns below end in word w of a CompactMazeGrid row.
+inline uint64_t columnMask(int w, int end)
+{
+    int bits = end - 64*w;
+    if (bits >= 64) return ~uint64_t(0);
+    return bits > 0? (uint64_t(1) << bits) - 1: 0;
+}
+
+// BinaryTreeMaze with each row's coins drawn from Pcg32(seed, row): bit c
+// of the row's 32-bit words says north (1) or east (0) for column c.
+template <typename Grid>
+void ParallelBinaryTreeMaze(Grid& maze, uint64_t seed, ThreadPool& pool)
+{
+    forEachRow(maze.rows, pool, [&](int row) {
+        Pcg32 prng(seed, row);
+        uint32_t coins = 0;
+        for (int col = 0; col < maze.columns; ++col) {
+            if (col % 32 == 0) coins = prng();
+            int cell = row*maze.columns + col;
+            if (row == 0)                   maze.link(cell, East);
+            else if (col == maze.columns-1) maze.link(cell, North);
+            else maze.link(cell, coins >> (col % 32) & 1? North: East);
+        }
+    });
+}
+
+// The same maze, 64 cells per step: the coins are the row's north word.
+inline void ParallelBinaryTreeMaze(CompactMazeGrid& maze, uint64_t seed, ThreadPool& pool)
+{
+    forEachRow(maze.rows, pool, [&](int row) {
+        Pcg32 prng(seed, row);
+        uint64_t* north = maze.northRow(row);
+        uint64_t* east = maze.eastRow(row);
+        for (int w = 0; w < maze.stride; ++w) {
+            uint64_t lo = prng(), hi = prng();
+            uint64_t coins = row? hi << 32 | lo: 0;
+            uint64_t cells = columnMask(w, maze.columns);
+            uint64_t inner = columnMask(w, maze.columns - 1);
+            east[w] = ~coins & inner;
+            north[w] = row? (coins | ~inner) & cells: 0;
+        }
+    });
+}
+
+// SidewinderMaze with each row drawn from Pcg32(seed, row): one bit per
+// cell for the coin, and a bounded draw to close each run.
+template <typename Grid>
+void ParallelSidewinderMaze(Grid& maze, uint64_t seed, ThreadPool& pool)
+{
+    forEachRow(maze.rows, pool, [&](int row) {
+        Pcg32 prng(seed, row);
+        uint32_t coins = 0;
+        int first = row*maze.columns, run_start = first;
+        for (int col = 0; col < maze.columns; ++col) {
+            if (col % 32 == 0) coins = prng();
+            int cell = first + col;
+            bool heads = coins >> (col % 32) & 1;
+            bool close_out = col == maze.columns-1 || (row > 0 && heads);
+
+            if (close_out) {
+                maze.link(run_start + RandomBounded::bounded(prng, cell - run_start + 1), North);
+                run_start = cell + 1;
+            }
+            else {
+                maze.link(cell, East);
+            }
+        }
+    });
+}
+
+// The same maze, setting the row's passage bits directly.
+inline void ParallelSidewinderMaze(CompactMazeGrid& maze, uint64_t seed, ThreadPool& pool)
+{
+    forEachRow(maze.rows, pool, [&](int row) {
+        Pcg32 prng(seed, row);
+        uint64_t* north = maze.northRow(row);
+        uint64_t* east = maze.eastRow(row);
+        uint32_t coins = 0;
+        int run_start = 0;
+        for (int col = 0; col < maze.columns; ++col) {
+            if (col % 32 == 0) coins = prng();
+            bool heads = coins >> (col % 32) & 1;
+            bool close_out = col == maze.columns-1 || (row > 0 && heads);
+
+            if (close_out) {
+                int member = run_start + RandomBounded::bounded(prng, col - run_start + 1);
+                if (row > 0) north[member / 64] |= uint64_t(1) << (member % 64);
+                run_start = col + 1;
+            }
+            else {
+                east[col / 64] |= uint64_t(1) << (col % 64);
+            }
+        }
+    });
+}
+
+// Eller's algorithm: a perfect maze generated one row at a time, holding
+// only the current row's sets, so memory is O(columns) however many rows.
+// Each finished row goes to sink(north, east) as the row's words in
+// CompactMazeGrid's layout, north passages first.
+template <typename Sink>
+void EllerMaze(int64_t rows, int columns, uint64_t seed, Sink&& sink)
+{
+    const int stride = (columns + 63) / 64;
+    Array<uint64_t> north(stride), east(stride), below(stride);
+    std::memset(&north[0], 0, sizeof(uint64_t) * stride);
+
+    // Set labels are column numbers, merged within a row by union-find.
+    Array<int> label(columns), parent(columns), chosen(columns), members(columns), unused(columns);
+    Array<bool> used(columns), down(columns);
+    for (int c = 0; c < columns; ++c) label[c] = c;
+
+    Pcg32 prng(seed);
+    auto random64 = [&]() {
+        uint64_t lo = prng();
+        return (uint64_t)prng() << 32 | lo;
+    };
+    auto find = [&](int set) {
+        while (parent[set] != set) set = parent[set] = parent[parent[set]];
+        return set;
+    };
+
+    for (int64_t row = 0; row < rows; ++row) {
+        bool last = row == rows - 1;
+        std::memset(&east[0], 0, sizeof(uint64_t) * stride);
+        std::memset(&below[0], 0, sizeof(uint64_t) * stride);
+        for (int c = 0; c < columns; ++c) parent[c] = c;
+
+        // Join neighbours in different sets at random, or always on the
+        // last row.  The coin flips are bits of random words, and the
+        // joins are branch free: the coins would defeat the predictor.
+        uint64_t coins = 0;
+        int a = find(label[0]);
+        for (int c = 0; c + 1 < columns; ++c) {
+            if (c % 64 == 0) coins = last? ~uint64_t(0): random64();
+            int b = find(label[c+1]);
+            uint64_t join = (a != b) & (coins >> (c % 64));
+            parent[b] = join? a: b;
+            east[c / 64] |= join << (c % 64);
+            a = join? a: b;
+        }
+
+        if (!last) {
+            // Carve down at random, then make sure every set goes down at
+            // least once, from a member chosen uniformly: a bounded draw
+            // only for the few sets that need it.
+            for (int w = 0; w < stride; ++w)
+                below[w] = random64() & columnMask(w, columns);
+            for (int c = 0; c < columns; ++c) {
+                label[c] = find(label[c]);
+                members[label[c]] = 0;
+                down[label[c]] = false;
+            }
+            for (int c = 0; c < columns; ++c) {
+                int set = label[c];
+                ++members[set];
+                chosen[set] = -1;
+                down[set] = down[set] | (below[c / 64] >> (c % 64) & 1);
+            }
+            for (int c = 0; c < columns; ++c) {
+                int set = label[c];
+                if (down[set]) continue;
+                if (chosen[set] < 0) chosen[set] = RandomBounded::bounded(prng, members[set]);
+                if (chosen[set]-- == 0) {
+                    below[c / 64] |= uint64_t(1) << (c % 64);
+                    down[set] = true;
+                }
+            }
+        }
+
+        sink(Span<const uint64_t>{ stride, &north[0] }, Span<const uint64_t>{ stride, &east[0] });
+        north.swap(below);
+
+        // Cells below a passage keep their set; the rest get unused labels.
+        for (int c = 0; c < columns; ++c) used[c] = false;
+        for (int c = 0; c < columns; ++c)
+            used[label[c]] = used[label[c]] | (north[c / 64] >> (c % 64) & 1);
+        int unused_count = 0;
+        for (int l = 0; l < columns; ++l) {
+            unused[unused_count] = l;
+            unused_count += !used[l];
+        }
+        for (int c = 0, k = 0; c < columns; ++c) {
+            bool kept = north[c / 64] >> (c % 64) & 1;
+            label[c] = kept? label[c]: unused[k];
+            k += !kept;
+        }
+    }
+}
+
+// An Eller's sink that appends each row's words to a file: 2*stride words
+// per row, north then east, in the machine's byte order.
+class MazeRowWriter {
+  public:
+    explicit MazeRowWriter(FILE* out) : file(out) {}
+
+    void operator()(Span<const uint64_t> north, Span<const uint64_t> east)
+    {
+        write(north);
+        write(east);
+    }
+
+  private:
+    void write(Span<const uint64_t> words)
+    {
+        if (fwrite(words.data, sizeof(uint64_t), words.size, file) != (size_t)words.size)
+            throw Fault(kwr_FileLine, strerror(errno));
+    }
+
+    FILE* file;
+};
+
+// Disjoint-set forest over 0..n-1 in flat arrays, with path halving and
+// union by rank.
+class DisjointSets {
+  public:
+    explicit DisjointSets(int n) : parent(n), rank(n)
+    {
+        for (int i = 0; i < n; ++i) parent[i] = i;
+        std::memset(&rank[0], 0, n);
+    }
+
+    int find(int x)
+    {
+        while (parent[x] != x) x = parent[x] = parent[parent[x]];
+        return x;
+    }
+
+    // find() without compression: only reads, so many threads may call it
+    // while nobody unites.
+    int root(int x) const
+    {
+        while (parent[x] != x) x = parent[x];
+        return x;
+    }
+
+    // False if a and b were already in one set.
+    bool unite(int a, int b)
+    {
+        a = find(a);
+        b = find(b);
+        if (a == b) return false;
+        if (rank[a] < rank[b]) std::swap(a, b);
+        parent[b] = a;
+        if (rank[a] == rank[b]) ++rank[a];
+        return true;
+    }
+
+  private:
+    Array<int> parent;
+    Array<uint8_t> rank;
+};
+
+// Kruskal's walls are numbered 2*cell for the east wall and 2*cell+1 for
+// the south wall of each cell; those on the boundary are never used.
+template <typename Grid>
+bool isInnerWall(const Grid& maze, int64_t wall)
+{
+    int cell = wall >> 1;
+    if (wall & 1) return cell < maze.size() - maze.columns;
+    return cell % maze.columns != maze.columns - 1;
+}
+
+// Opens the wall if it joins two different sets.
+template <typename Grid>
+void kruskalStep(Grid& maze, DisjointSets& sets, int64_t wall)
+{
+    int cell = wall >> 1;
+    bool south = wall & 1;
+    if (sets.unite(cell, south? cell + maze.columns: cell + 1))
+        maze.link(cell, south? South: East);
+}
+
+// Randomised Kruskal: every inner wall in random order, opened whenever it
+// separates two sets.  The order is a Fisher-Yates shuffle with Pcg32.
+template <typename Grid>
+void KruskalMaze(Grid& maze, uint32_t seed)
+{
+    Array<int> walls(maze.rows * (maze.columns - 1) + (maze.rows - 1) * maze.columns);
+    int count = 0;
+    for (int64_t wall = 0; wall < 2 * (int64_t)maze.size(); ++wall)
+        if (isInnerWall(maze, wall)) walls[count++] = wall;
+
+    FisherYatesShuffler<Pcg32> shuffler { Pcg32(seed) };
+    shuffler.shuffle(&walls[0], count);
+
+    DisjointSets sets(maze.size());
+    for (int k = 0; k < count; ++k)
+        kruskalStep(maze, sets, walls[k]);
+}
+
+// Sorts one bucket of ParallelKruskalMaze's keys.  They share their top
+// byte and arrive in wall order, so a stable LSD radix sort on bits 32-55
+// leaves them in full key order.
+inline void sortKeys(uint64_t* keys, uint64_t* scratch, int64_t n)
+{
+    int64_t counts[3][256] = {};
+    for (int64_t k = 0; k < n; ++k)
+        for (int d = 0; d < 3; ++d)
+            ++counts[d][keys[k] >> (32 + 8*d) & 255];
+
+    uint64_t* from = keys;
+    uint64_t* to = scratch;
+    for (int d = 0; d < 3; ++d) {
+        int64_t next = 0;
+        for (int64_t& count : counts[d]) {
+            int64_t size = count;
+            count = next;
+            next += size;
+        }
+        for (int64_t k = 0; k < n; ++k)
+            to[counts[d][from[k] >> (32 + 8*d) & 255]++] = from[k];
+        std::swap(from, to);
+    }
+    std::memcpy(keys, from, sizeof(uint64_t) * n);
+}
+
+// Kruskal with each wall's place in the order given by a random key, the
+// wall's draw from SplitMix64 above its number: a pure function of seed and
+// wall, so the maze does not depend on the thread count.  Keys are counted
+// and scattered into Buckets ranges in parallel.  Then, range by range,
+// walls whose cells are already joined are filtered out in parallel, as in
+// Filter-Kruskal, and only the survivors are sorted and united.  Most walls
+// in later ranges are filtered, which is where the speedup comes from.
+template <typename Grid>
+void ParallelKruskalMaze(Grid& maze, uint64_t seed, ThreadPool& pool)
+{
+    const int Buckets = 256, Chunks = 64;
+    const int64_t wall_count = 2 * (int64_t)maze.size();
+    auto key = [&](int64_t wall) {
+        uint64_t x = seed + wall * 0x9E3779B97F4A7C15ULL;
+        return splitmix64(x) >> 32 << 32 | (uint64_t)wall;
+    };
+    auto chunk_start = [&](int chunk) { return wall_count * chunk / Chunks; };
+
+    // counts[chunk][bucket] become each chunk's offsets into each bucket.
+    Array<int64_t> counts(Chunks * Buckets), bucket_start(Buckets + 1);
+    pool.run(Chunks, [&](int chunk) {
+        int64_t* count = &counts[chunk * Buckets];
+        std::fill(count, count + Buckets, 0);
+        for (int64_t wall = chunk_start(chunk); wall < chunk_start(chunk+1); ++wall)
+            if (isInnerWall(maze, wall)) ++count[key(wall) >> 56];
+    });
+    int64_t total = 0;
+    for (int b = 0; b < Buckets; ++b) {
+        bucket_start[b] = total;
+        for (int chunk = 0; chunk < Chunks; ++chunk) {
+            int64_t n = counts[chunk * Buckets + b];
+            counts[chunk * Buckets + b] = total;
+            total += n;
+        }
+    }
+    bucket_start[Buckets] = total;
+
+    Array<uint64_t> keys(total);
+    pool.run(Chunks, [&](int chunk) {
+        int64_t* next = &counts[chunk * Buckets];
+        for (int64_t wall = chunk_start(chunk); wall < chunk_start(chunk+1); ++wall) {
+            if (!isInnerWall(maze, wall)) continue;
+            uint64_t k = key(wall);
+            keys[next[k >> 56]++] = k;
+        }
+    });
+
+    int64_t largest = 0;
+    for (int b = 0; b < Buckets; ++b)
+        largest = std::max(largest, bucket_start[b+1] - bucket_start[b]);
+    Array<uint64_t> scratch(largest);
+
+    DisjointSets sets(maze.size());
+    Array<int64_t> kept(Chunks);
+    for (int b = 0; b < Buckets; ++b) {
+        uint64_t* first = &keys[0] + bucket_start[b];
+        int64_t size = bucket_start[b+1] - bucket_start[b];
+
+        // Each slice packs its survivors to its front; then close the gaps.
+        // Below half the walls the grid's components are small (bond
+        // percolation on the square lattice starts at 1/2), so almost every
+        // wall survives and filtering would be wasted.
+        int64_t survivors = size;
+        if (b >= Buckets / 2) {
+            pool.run(Chunks, [&](int slice) {
+                int64_t begin = size * slice / Chunks, end = size * (slice+1) / Chunks;
+                int64_t n = 0;
+                for (int64_t k = begin; k < end; ++k) {
+                    int cell = (uint32_t)first[k] >> 1;
+                    int other = first[k] & 1? cell + maze.columns: cell + 1;
+                    if (sets.root(cell) != sets.root(other)) first[begin + n++] = first[k];
+                }
+                kept[slice] = n;
+            });
+            survivors = 0;
+            for (int slice = 0; slice < Chunks; ++slice) {
+                int64_t begin = size * slice / Chunks;
+                std::memmove(first + survivors, first + begin, sizeof(uint64_t) * kept[slice]);
+                survivors += kept[slice];
+            }
+        }
+
+        sortKeys(first, &scratch[0], survivors);
+        for (int64_t k = 0; k < survivors; ++k)
+            kruskalStep(maze, sets, (uint32_t)first[k]);
+    }
+}
+
+// Recursive backtracker as a loop: a depth-first walk that opens a wall to
+// a random unvisited neighbour, or steps back when there is none.  The
+// stack holds the direction of each step, one byte per cell, and backing
+// up goes the opposite way.  Visited cells are a bitset.  Cells outside
+// the grid are replaced by the current cell, which is already visited, so
+// the neighbour mask needs no branches.  A table then picks a set bit.
+template <typename Grid>
+void RecursiveBacktrackerMaze(Grid& maze, uint32_t seed)
+{
+    const int rows = maze.rows, columns = maze.columns;
+    const int step[4] = { -columns, 1, -1, columns };
+    const int row_step[4] = { -1, 0, 0, 1 };
+    const int column_step[4] = { 0, 1, -1, 0 };
+
+    // choice[mask][k] is the direction of the k-th set bit of mask.
+    uint8_t choice[16][4] = {}, count[16] = {};
+    for (int mask = 0; mask < 16; ++mask)
+        for (int d = 0; d < 4; ++d)
+            if (mask >> d & 1) choice[mask][count[mask]++] = d;
+
+    Array<uint64_t> visited((maze.size() + 63) / 64);
+    std::memset(&visited[0], 0, sizeof(uint64_t) * visited.size());
+    auto seen = [&](int i) { return visited[i / 64] >> (i % 64) & 1; };
+    auto mark = [&](int i) { visited[i / 64] |= uint64_t(1) << (i % 64); };
+
+    Array<uint8_t> stack(maze.size());
+    int depth = 0;
+
+    Pcg32 prng(seed);
+    int cell = RandomBounded::bounded(prng, maze.size());
+    int row = cell / columns, column = cell % columns;
+    mark(cell);
+
+    for (;;) {
+        const bool inside[4] = { row > 0, column < columns-1, column > 0, row < rows-1 };
+        unsigned mask = 0;
+        for (int d = 0; d < 4; ++d) {
+            int next = inside[d]? cell + step[d]: cell;
+            mask |= unsigned(!seen(next)) << d;
+        }
+
+        if (mask) {
+            int d = choice[mask][RandomBounded::bounded(prng, count[mask])];
+            maze.link(cell, d);
+            stack[depth++] = d;
+            cell += step[d];
+            row += row_step[d];
+            column += column_step[d];
+            mark(cell);
+        }
+        else {
+            if (depth == 0) break;
+            int d = opposite(stack[--depth]);
+            cell += step[d];
+            row += row_step[d];
+            column += column_step[d];
+        }
+    }
+}
+
+// One bit per cell.
+class CellBits {
+  public:
+    explicit CellBits(int n) : words((n + 63) / 64)
+    {
+        std::memset(&words[0], 0, sizeof(uint64_t) * words.size());
+    }
+
+    bool operator[](int i) const { return words[i / 64] >> (i % 64) & 1; }
+    void set(int i) { words[i / 64] |= uint64_t(1) << (i % 64); }
+
+  private:
+    Array<uint64_t> words;
+};
+
+// A cell with its row and column, for random walks that must not leave
+// the grid.
+class GridCursor {
+  public:
+    GridCursor(int rs, int cs, int i) :
+      rows(rs), columns(cs), cell(i), row(i / cs), column(i % cs) {}
+
+    bool canMove(int direction) const
+    {
+        switch (direction) {
+          case North: return row > 0;
+          case East:  return column < columns-1;
+          case West:  return column > 0;
+          default:    return row < rows-1;
+        }
+    }
+
+    void move(int direction)
+    {
+        static const int row_step[4] = { -1, 0, 0, 1 };
+        static const int column_step[4] = { 0, 1, -1, 0 };
+        row += row_step[direction];
+        column += column_step[direction];
+        cell += row_step[direction] * columns + column_step[direction];
+    }
+
+    int rows, columns;
+    int cell, row, column;
+};
+
+// Random directions, two bits each, from Pcg32 words filled Words at a time.
+class RandomDirections {
+  public:
+    explicit RandomDirections(uint32_t seed) : prng(seed) {}
+
+    int operator()()
+    {
+        if (pairs == 0) {
+            if (next == Words) {
+                prng.fill(buffer, Words);
+                next = 0;
+            }
+            word = buffer[next++];
+            pairs = 16;
+        }
+        int direction = word & 3;
+        word >>= 2;
+        --pairs;
+        return direction;
+    }
+
+  private:
+    static const int Words = 256;
+    Pcg32 prng;
+    uint32_t buffer[Words];
+    uint32_t word = 0;
+    int next = Words, pairs = 0;
+};
+
+// A step of a simple random walk: a direction drawn again until it stays
+// inside the grid, which makes it uniform over the cell's neighbours.
+inline int randomStep(GridCursor& at, RandomDirections& random)
+{
+    int direction;
+    do direction = random();
+    while (!at.canMove(direction));
+    at.move(direction);
+    return direction;
+}
+
+// Uniform spanning trees, every perfect maze equally likely.  Where the
+// walks start does not affect that, but it does affect the time: walks
+// find a tree rooted in the middle of the grid sooner than one in a corner.
+inline int middleCell(int rows, int columns) { return rows / 2 * columns + columns / 2; }
+
+// Aldous-Broder: a random walk from the middle cell that joins each cell
+// to the tree by the step that first reaches it.  Quick while most cells
+// are new, but the last few take a long time to find.
+template <typename Grid>
+void AldousBroderMaze(Grid& maze, uint32_t seed)
+{
+    RandomDirections random(seed);
+    CellBits visited(maze.size());
+    GridCursor at(maze.rows, maze.columns, middleCell(maze.rows, maze.columns));
+    visited.set(at.cell);
+    for (int unvisited = maze.size() - 1; unvisited > 0; ) {
+        int direction = randomStep(at, random);
+        if (!visited[at.cell]) {
+            visited.set(at.cell);
+            maze.link(at.cell, opposite(direction));
+            --unvisited;
+        }
+    }
+}
+
+// Wilson's: a loop-erased random walk from each cell not yet in the tree,
+// which starts as the middle cell.  Each walk keeps only its last exit
+// from each cell, so loops erase themselves; on reaching the tree the path
+// is retraced and joined to it.  The first walks wander long before
+// finding the one-cell tree, then they speed up as it grows.
+template <typename Grid>
+void WilsonMaze(Grid& maze, uint32_t seed)
+{
+    RandomDirections random(seed);
+    CellBits in_tree(maze.size());
+    Array<uint8_t> exit(maze.size());
+    in_tree.set(middleCell(maze.rows, maze.columns));
+
+    for (int start = 0; start < maze.size(); ++start) {
+        if (in_tree[start]) continue;
+
+        GridCursor at(maze.rows, maze.columns, start);
+        while (!in_tree[at.cell]) {
+            int cell = at.cell;
+            exit[cell] = randomStep(at, random);
+        }
+
+        GridCursor path(maze.rows, maze.columns, start);
+        while (!in_tree[path.cell]) {
+            int direction = exit[path.cell];
+            in_tree.set(path.cell);
+            maze.link(path.cell, direction);
+            path.move(direction);
+        }
+    }
+}
+
+} // kwr
+
+#endif
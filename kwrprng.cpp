@@ -1,41 +1,54 @@
 #include "kwrprng.h"
-#include <limits>
 
 namespace kwr {
 
 
-ComplimentaryMultiplyWithCarry::ComplimentaryMultiplyWithCarry(uint32_t seed) 
+AliasSampler::AliasSampler(const double* weights, int n) :
+  threshold(n), alias(n)
 {
-  // 4096 random 32-bit integers for Q[]
-  MINSTD minstd(seed);
-  for (int q = 0; q < qSize; ++q)
-    Q[q] = minstd();
-
-  // Init c to random < cMax
-  while (c = minstd() >= cMax) {}
-}
+  kwr_require(n > 0);
+  double total = 0;
+  for (int k = 0; k < n; ++k) {
+    kwr_require(weights[k] >= 0 && std::isfinite(weights[k]));
+    total += weights[k];
+  }
+  kwr_require(total > 0 && std::isfinite(total));
+
+  // Scale so the average column holds exactly 1, then pair each under-full
+  // column with an over-full one that tops it up.
+  Array<double> scaled(n);
+  Array<int> small(n), large(n);
+  int smalls = 0, larges = 0;
+
+  for (int k = 0; k < n; ++k) {
+    scaled[k] = weights[k] * n / total;
+    if (scaled[k] < 1.0) small[smalls++] = k;
+    else                 large[larges++] = k;
+  }
 
-void ComplimentaryMultiplyWithCarry::next()
-{
-  uint64_t t;
-  uint32_t x;
+  while (smalls && larges) {
+    int s = small[--smalls];
+    int l = large[--larges];
 
-  i = (i + 1) & (qSize-1);
-  t = a * Q[i] + c;
-  c = (t >> 32); 
-  x = t + c; 
+    threshold[s] = scaled[s] * 4294967296.0;
+    alias[s] = l;
 
-  if (x < c) {
-    ++x;
-    ++c;
+    scaled[l] -= 1.0 - scaled[s];
+    if (scaled[l] < 1.0) small[smalls++] = l;
+    else                 large[larges++] = l;
   }
 
-  Q[i] = r - x;
-}
-
-uint32_t ComplimentaryMultiplyWithCarry::max() const 
-{
-  return std::numeric_limits<Type>::max(); 
+  // Whatever is left is full to within rounding: always keep the column.
+  while (larges) {
+    int l = large[--larges];
+    threshold[l] = 0xFFFFFFFF;
+    alias[l] = l;
+  }
+  while (smalls) {
+    int s = small[--smalls];
+    threshold[s] = 0xFFFFFFFF;
+    alias[s] = s;
+  }
 }
 
 
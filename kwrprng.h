@@ -1,7 +1,17 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <cstring>
+#include <array>
+#include <cmath>
 #include "kwrlib.h"
+#include "kwrthread.h"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 //======================================================================
 // Pseudo-Random Number Generation
@@ -17,6 +27,19 @@ class RandomSequence : public Sequence {
 };
 
 
+// One 32-bit word from any generator.  The 64-bit generators give their
+// high half, which is the strongest, so the 32-bit adapters below can take
+// either kind.
+template <typename PRNG>
+constexpr uint32_t draw32(PRNG& prng)
+{
+    if constexpr (sizeof prng() > sizeof(uint32_t))
+        return prng() >> 32;
+    else
+        return prng();
+}
+
+
 /* XorShift template options
    | 1, 3,10| 1, 5,16| 1, 5,19| 1, 9,29| 1,11, 6| 1,11,16| 1,19, 3| 1,21,20| 1,27,27|
    | 2, 5,15| 2, 5,21| 2, 7, 7| 2, 7, 9| 2, 7,25| 2, 9,15| 2,15,17| 2,15,25| 2,21, 9|
@@ -29,6 +52,39 @@ class RandomSequence : public Sequence {
    |13, 3,27|13, 5,19|13,17,15|14, 1,15|14,13,15|15, 1,29|17,15,20|17,15,23|17,15,26|
    */
 
+// 32x32 matrix over GF(2), stored as the images of the unit vectors.
+// XorShift steps are linear in GF(2), so their powers jump the sequence.
+class BitMatrix {
+  public:
+    template <typename Step>
+    static BitMatrix from(Step step)
+    {
+        BitMatrix m;
+        for (int j = 0; j < 32; ++j)
+            m.columns[j] = step(1U << j);
+        return m;
+    }
+
+    uint32_t operator()(uint32_t x) const
+    {
+        uint32_t y = 0;
+        for (int j = 0; x; ++j, x >>= 1)
+            if (x & 1) y ^= columns[j];
+        return y;
+    }
+
+    BitMatrix operator*(const BitMatrix& that) const
+    {
+        BitMatrix m;
+        for (int j = 0; j < 32; ++j)
+            m.columns[j] = (*this)(that.columns[j]);
+        return m;
+    }
+
+  private:
+    uint32_t columns[32] {};
+};
+
 template <int a, int b, int c>
 class XorShift : public RandomSequence
 {
@@ -38,139 +94,1561 @@ class XorShift : public RandomSequence
     explicit XorShift(uint32_t s) throw() : seed(s) {}
 
     virtual uint32_t get() const { return seed; }
+    virtual void next() { seed = step(seed); }
 
-    virtual void next()
+    inline uint32_t operator()() { return seed = step(seed); }
+
+    // Bulk fill, same values as n calls to operator().
+    void fill(uint32_t* out, size_t n)
+    {
+        uint32_t x = seed;
+        for (size_t k = 0; k < n; ++k)
+            out[k] = x = step(x);
+        seed = x;
+    }
+
+    void fill(Span<uint32_t> out) { fill(out.data, out.size); }
+
+    // Same state as n calls to next(), in O(log n) matrix products.
+    void advance(uint64_t n)
     {
-        seed ^= (seed << a);
-        seed ^= (seed >> b);
-        seed ^= (seed << c);
+        BitMatrix power = BitMatrix::from(step);
+        for (; n; n >>= 1) {
+            if (n & 1) seed = power(seed);
+            power = power * power;
+        }
     }
 
-    inline uint32_t operator()() { next(); return get(); }
+    // Checkpoint and restore: load(save()) continues the exact stream.
+    struct State { uint32_t seed; };
+    State save() const { return { seed }; }
+    void load(const State& state) { seed = state.seed; }
+
+    static constexpr uint32_t step(uint32_t x)
+    {
+        x ^= (x << a);
+        x ^= (x >> b);
+        x ^= (x << c);
+        return x;
+    }
 
   private:
     uint32_t seed;
 };
 
-typedef XorShift<13,7,17> XorShift0;  // Marsaglia's favorite XorShift parameters
+typedef XorShift<13,17,5> XorShift0;  // Marsaglia's favorite 32-bit XorShift parameters
+
+// Murmur3 finalizer: a bijective 32-bit mix, zero only for zero.
+inline uint32_t hash32(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x85ebca6bU;
+    x ^= x >> 13;
+    x *= 0xc2b2ae35U;
+    x ^= x >> 16;
+    return x;
+}
+
+// Lane-wise 32-bit operations so one kernel serves scalar, SSE2, AVX2 and
+// AVX-512 registers.
+namespace simd {
+
+template <int n> inline uint32_t shiftLeft(uint32_t x)  { return x << n; }
+template <int n> inline uint32_t shiftRight(uint32_t x) { return x >> n; }
+inline uint32_t bitXor(uint32_t x, uint32_t y) { return x ^ y; }
+inline void load(uint32_t& v, const uint32_t* p) { v = *p; }
+inline void store(uint32_t* p, uint32_t v) { *p = v; }
+
+#if defined(__SSE2__)
+template <int n> inline __m128i shiftLeft(__m128i x)  { return _mm_slli_epi32(x, n); }
+template <int n> inline __m128i shiftRight(__m128i x) { return _mm_srli_epi32(x, n); }
+inline __m128i bitXor(__m128i x, __m128i y) { return _mm_xor_si128(x, y); }
+inline void load(__m128i& v, const uint32_t* p) { v = _mm_loadu_si128((const __m128i*)p); }
+inline void store(uint32_t* p, __m128i v) { _mm_storeu_si128((__m128i*)p, v); }
+#endif
+
+#if defined(__AVX2__)
+template <int n> inline __m256i shiftLeft(__m256i x)  { return _mm256_slli_epi32(x, n); }
+template <int n> inline __m256i shiftRight(__m256i x) { return _mm256_srli_epi32(x, n); }
+inline __m256i bitXor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+inline void load(__m256i& v, const uint32_t* p) { v = _mm256_loadu_si256((const __m256i*)p); }
+inline void store(uint32_t* p, __m256i v) { _mm256_storeu_si256((__m256i*)p, v); }
+#endif
+
+#if defined(__AVX512F__)
+template <int n> inline __m512i shiftLeft(__m512i x)  { return _mm512_slli_epi32(x, n); }
+template <int n> inline __m512i shiftRight(__m512i x) { return _mm512_srli_epi32(x, n); }
+inline __m512i bitXor(__m512i x, __m512i y) { return _mm512_xor_si512(x, y); }
+inline void load(__m512i& v, const uint32_t* p) { v = _mm512_loadu_si512(p); }
+inline void store(uint32_t* p, __m512i v) { _mm512_storeu_si512(p, v); }
+#endif
+
+} // simd
+
+// Lanes independent XorShift<a,b,c> states advanced together in vector
+// registers.  Output is interleaved: value k*Lanes+l comes from lane l.
+template <int a, int b, int c, int Lanes>
+class XorShiftN : public RandomSequence
+{
+  public:
+    typedef uint32_t Type;
+
+    explicit XorShiftN(uint32_t seed)
+    {
+        for (int l = 0; l < Lanes; ++l) {
+            state[l] = hash32(seed + 0x9E3779B9U * (l + 1));
+            if (!state[l]) state[l] = l + 1;
+        }
+    }
+
+    virtual uint32_t get() const { return block[index]; }
+
+    virtual void next()
+    {
+        if (++index == Lanes) {
+            generate(block, 1);
+            index = 0;
+        }
+    }
+
+    inline uint32_t operator()() { XorShiftN::next(); return block[index]; }
+
+    void fill(uint32_t* out, size_t n)
+    {
+        size_t k = 0;
+        for (; k < n && index < Lanes-1; ++k)
+            out[k] = block[++index];
+
+        size_t blocks = (n - k) / Lanes;
+        if (blocks) {
+            generate(out + k, blocks);
+            k += blocks * Lanes;
+            std::memcpy(block, out + k - Lanes, sizeof block);
+        }
+
+        for (; k < n; ++k)
+            out[k] = (*this)();
+    }
+
+    void fill(Span<uint32_t> out) { fill(out.data, out.size); }
+
+    struct State { uint32_t state[Lanes], block[Lanes]; int index; };
+
+    State save() const
+    {
+        State saved;
+        std::memcpy(saved.state, state, sizeof state);
+        std::memcpy(saved.block, block, sizeof block);
+        saved.index = index;
+        return saved;
+    }
+
+    void load(const State& saved)
+    {
+        kwr_require(saved.index >= 0 && saved.index < (int)Lanes);
+        std::memcpy(state, saved.state, sizeof state);
+        std::memcpy(block, saved.block, sizeof block);
+        index = saved.index;
+    }
+
+  private:
+    void generate(uint32_t* out, size_t blocks)
+    {
+#if defined(__AVX512F__)
+        if constexpr (Lanes % 16 == 0) { generate<__m512i>(out, blocks); return; }
+#endif
+#if defined(__AVX2__)
+        if constexpr (Lanes % 8 == 0) { generate<__m256i>(out, blocks); return; }
+#endif
+#if defined(__SSE2__)
+        if constexpr (Lanes % 4 == 0) { generate<__m128i>(out, blocks); return; }
+#endif
+        generate<uint32_t>(out, blocks);
+    }
+
+    template <typename Vector>
+    void generate(uint32_t* out, size_t blocks)
+    {
+        using namespace simd;
+        const int width = sizeof(Vector) / sizeof(uint32_t);
+        const int count = Lanes / width;
+
+        Vector s[count];
+        for (int v = 0; v < count; ++v)
+            simd::load(s[v], state + v*width);
+
+        for (size_t k = 0; k < blocks; ++k, out += Lanes) {
+            for (int v = 0; v < count; ++v) {
+                s[v] = bitXor(s[v], shiftLeft<a>(s[v]));
+                s[v] = bitXor(s[v], shiftRight<b>(s[v]));
+                s[v] = bitXor(s[v], shiftLeft<c>(s[v]));
+                store(out + v*width, s[v]);
+            }
+        }
+
+        for (int v = 0; v < count; ++v)
+            store(state + v*width, s[v]);
+    }
+
+    uint32_t state[Lanes];
+    uint32_t block[Lanes] {};
+    int index = Lanes - 1;
+};
 
 template<uint32_t a, uint32_t c, uint32_t m>
-class LinearCongruentialGenerator
+class LinearCongruentialGenerator : public RandomSequence
 {
   public:
     typedef uint32_t Type;
 
     explicit LinearCongruentialGenerator(uint32_t seed) : x(seed) {}
-    inline uint32_t operator()() { next(); return get(); }
+    inline uint32_t operator()() { return x = step(x); }
 
     virtual uint32_t get() const { return x; }
-    virtual void next() { x = ((uint64_t)a * x + c) % m; }
+    virtual void next() { x = step(x); }
+
+    void fill(uint32_t* out, size_t n)
+    {
+        const size_t lanes = 8;
+        uint32_t s = x;
+        size_t k = 0;
+        for (; k < n && k < lanes; ++k)
+            out[k] = s = step(s);
+
+        // Eight interleaved chains x[k] = A*x[k-8] + C, where (A, C) is the
+        // step applied eight times.  Unlike the single chain they vectorise.
+        constexpr Affine jump = power(lanes);
+        for (; k < n; ++k)
+            out[k] = reduce(jump.mul * out[k-lanes] + jump.add);
+
+        if (n) x = out[n-1];
+    }
+
+    void fill(Span<uint32_t> out) { fill(out.data, out.size); }
+
+    // Same state as n calls to next().
+    void advance(uint64_t n)
+    {
+        Affine jump = power(n);
+        x = reduce(jump.mul * x + jump.add);
+    }
+
+    struct State { uint32_t x; };
+    State save() const { return { x }; }
+    void load(const State& state) { x = state.x; }
+
+    static constexpr uint32_t step(uint32_t s) { return reduce((uint64_t)a * s + c); }
 
   private:
+    struct Affine { uint64_t mul, add; };
+
+    // The map x -> a*x+c composed with itself n times, by repeated squaring.
+    static constexpr Affine power(uint64_t n)
+    {
+        Affine result { 1, 0 };
+        uint64_t step_mul = a % m, step_add = c % m;
+        for (; n; n >>= 1) {
+            if (n & 1) {
+                result.mul = result.mul * step_mul % m;
+                result.add = (result.add * step_mul + step_add) % m;
+            }
+            step_add = (step_mul + 1) * step_add % m;
+            step_mul = step_mul * step_mul % m;
+        }
+        return result;
+    }
+
+    // p mod m, without a divide for the Mersenne prime 2^31-1.
+    static constexpr uint32_t reduce(uint64_t p)
+    {
+        if (m != 0x7FFFFFFFU) return p % m;
+        p = (p & m) + (p >> 31);
+        p = (p & m) + (p >> 31);
+        return p >= m? p - m: p;
+    }
+
     uint32_t x = 1;
 };
 
 typedef LinearCongruentialGenerator<48271U,0U,2147483647U> MINSTD;
 typedef LinearCongruentialGenerator<69069U,362437U,2147483647U> MarsagliaLCG;
 
-// https://en.wikipedia.org/wiki/Multiply-with-carry
-class ComplimentaryMultiplyWithCarry : public RandomSequence
+// Literal-type engines for building tables at compile time.  They produce
+// the same streams as XorShift and LinearCongruentialGenerator.
+template <int a, int b, int c>
+class XorShiftEngine
 {
   public:
     typedef uint32_t Type;
 
-    ComplimentaryMultiplyWithCarry(uint32_t seed);
-    uint32_t operator()() { next(); return get(); }
-    virtual uint32_t get() const { return Q[i]; }
-    virtual void next();
-    uint32_t max() const;
+    constexpr explicit XorShiftEngine(uint32_t s) : seed(s) {}
+    constexpr uint32_t operator()() { return seed = XorShift<a,b,c>::step(seed); }
 
   private:
+    uint32_t seed;
+};
+
+template<uint32_t a, uint32_t c, uint32_t m>
+class LinearCongruentialEngine
+{
+  public:
+    typedef uint32_t Type;
 
-    // Constants as Marsaglia recommended
-    static const uint64_t a = 18782LL;     
-    static const uint32_t r = 0xfffffffe;
-    static const unsigned qSize = 4096;
-    static const unsigned cMax = 809430660;
+    constexpr explicit LinearCongruentialEngine(uint32_t seed) : x(seed) {}
+    constexpr uint32_t operator()() { return x = LinearCongruentialGenerator<a,c,m>::step(x); }
 
-    uint32_t Q[qSize], c = 362436; /* random initial c < 809430660 */
-    uint32_t i = qSize - 1;
+  private:
+    uint32_t x;
 };
 
-class RandomUniform : public RandomSequence
+typedef XorShiftEngine<13,17,5> XorShift0Engine;
+typedef LinearCongruentialEngine<48271U,0U,2147483647U> MinstdEngine;
+
+// https://en.wikipedia.org/wiki/Multiply-with-carry
+// Marsaglia's complementary multiply-with-carry, lag r = Lag.  The state
+// is Lag words plus a carry, so small lags are cheap to hold and to reseed.
+// Multiplier must make Multiplier*(2^32-1)^Lag + 1 prime; see the typedefs.
+template <unsigned Lag, uint32_t Multiplier>
+class CMWC : public RandomSequence
 {
+    static_assert(Lag && (Lag & (Lag-1)) == 0, "CMWC lag must be a power of two");
+
   public:
     typedef uint32_t Type;
 
-    RandomUniform(Type lower, Type end, RandomSequence* rnd) :
-      start(lower), dist(end - lower), prng(rnd) 
+    explicit CMWC(uint32_t s) { seed(s); }
+
+    // Restart the stream in place, as if freshly constructed from s.  The
+    // lag table comes from MINSTD's interleaved fill, which vectorises.
+    void seed(uint32_t s)
     {
-        // Require lower < end
+        MINSTD minstd(s);
+        minstd.fill(Q, Lag);
+        c = (uint64_t)minstd() * Multiplier >> 31;  // c < Multiplier
+        i = Lag - 1;
     }
 
-    template <typename PRNG>
-    Type operator()(PRNG& prng) 
+    uint32_t operator()() { CMWC::next(); return Q[i]; }
+    virtual uint32_t get() const { return Q[i]; }
+    virtual void next()
     {
-        if (!dist) return start;
-        Type r;
-        while ((r = prng()) < threshold) {};
-        return start + (r % dist);
+        i = (i + 1) & (Lag-1);
+        Q[i] = step(Q[i], c);
     }
+    uint32_t max() const { return 0xFFFFFFFFU; }
 
-    virtual uint32_t get() const { return value; }
+    // Same recurrence as next(), with the lag index and carry held in locals
+    // so they stay in registers for the whole loop.
+    void fill(uint32_t* out, size_t n)
+    {
+        unsigned q = i;
+        uint32_t carry = c;
+        for (size_t k = 0; k < n; ++k) {
+            q = (q + 1) & (Lag-1);
+            out[k] = Q[q] = step(Q[q], carry);
+        }
+        i = q;
+        c = carry;
+    }
+
+    void fill(Span<uint32_t> out) { fill(out.data, out.size); }
+
+    // The whole lag table: 4 * (Lag + 2) bytes.
+    struct State { uint32_t Q[Lag]; uint32_t c, i; };
+
+    State save() const
+    {
+        State state;
+        std::memcpy(state.Q, Q, sizeof Q);
+        state.c = c;
+        state.i = i;
+        return state;
+    }
+
+    void load(const State& state)
+    {
+        kwr_require(state.i < Lag && state.c < Multiplier);
+        std::memcpy(Q, state.Q, sizeof Q);
+        c = state.c;
+        i = state.i;
+    }
+
+  private:
+    static uint32_t step(uint32_t q, uint32_t& carry)
+    {
+        uint64_t t = (uint64_t)Multiplier * q + carry;
+        carry = t >> 32;
+        uint32_t x = t + carry;
+        if (x < carry) {
+            ++x;
+            ++carry;
+        }
+        return 0xFFFFFFFEU - x;
+    }
+
+    uint32_t Q[Lag];
+    uint32_t c = 0;
+    unsigned i = Lag - 1;
+};
+
+// Multipliers as Marsaglia recommended for each lag.
+typedef CMWC<4096, 18782>     ComplimentaryMultiplyWithCarry;
+typedef CMWC<256, 987662290>  CMWC256;
+typedef CMWC<32, 987655670>   CMWC32;
+typedef CMWC<8, 987651386>    CMWC8;
+
+// Philox4x32-10 counter-based generator (Salmon et al., "Parallel Random
+// Numbers: As Easy as 1, 2, 3").  Each 128-bit counter is encrypted under a
+// 64-bit key to give four independent words, so random(key, index) is a pure
+// function: values can be drawn in any order, on any thread.
+class Philox : public RandomSequence
+{
+  public:
+    typedef uint32_t Type;
+
+    struct Block { uint32_t word[4]; };
+
+    // One stream per (key, stream) pair, indexed from zero.
+    explicit Philox(uint64_t k, uint64_t s = 0) : key(k), stream(s) {}
+
+    virtual uint32_t get() const { return block.word[index & 3]; }
 
     virtual void next()
     {
-        if (dist) {
-            do {
-                prng->next();
+        if ((++index & 3) == 0)
+            block = generate(key, stream, index >> 2);
+    }
+
+    inline uint32_t operator()() { Philox::next(); return block.word[index & 3]; }
+
+    void fill(uint32_t* out, size_t n)
+    {
+        // What is left of the current block, then whole blocks, then fewer
+        // than four values from the next block.
+        size_t head = std::min<size_t>(n, 3 - (index & 3));
+        size_t blocks = (n - head) / 4;
+        size_t tail = (n - head) % 4;
+
+        for (size_t k = 0; k < head; ++k)
+            out[k] = (*this)();
+        out += head;
+
+        uint64_t counter = (index + 1) >> 2;
+        for (size_t b = 0; b < blocks; ++b, out += 4) {
+            block = generate(key, stream, counter + b);
+            std::memcpy(out, block.word, sizeof block.word);
+        }
+        index += 4 * blocks;
+
+        for (size_t k = 0; k < tail; ++k)
+            out[k] = (*this)();
+    }
+
+    void fill(Span<uint32_t> out) { fill(out.data, out.size); }
+
+    void advance(uint64_t n)
+    {
+        index += n;
+        block = generate(key, stream, index >> 2);
+    }
+
+    // The current block is recomputed from the counter, not saved.
+    struct State { uint64_t key, stream, index; };
+    State save() const { return { key, stream, index }; }
+
+    void load(const State& state)
+    {
+        key = state.key;
+        stream = state.stream;
+        index = state.index;
+        block = generate(key, stream, index >> 2);
+    }
+
+    // Value number index of stream zero under key.
+    static uint32_t random(uint64_t key, uint64_t index)
+    {
+        return generate(key, 0, index >> 2).word[index & 3];
+    }
+
+    static Block generate(uint64_t key, uint64_t stream, uint64_t counter)
+    {
+        uint32_t c0 = counter, c1 = counter >> 32, c2 = stream, c3 = stream >> 32;
+        uint32_t k0 = key, k1 = key >> 32;
+
+        for (int round = 0; round < 10; ++round) {
+            if (round) {
+                k0 += 0x9E3779B9U;
+                k1 += 0xBB67AE85U;
             }
-            while (prng->get() < threshold);
-            value = start + (prng->get() % dist);
+            uint64_t p0 = (uint64_t)0xD2511F53U * c0;
+            uint64_t p1 = (uint64_t)0xCD9E8D57U * c2;
+            uint32_t hi0 = p0 >> 32, lo0 = p0;
+            uint32_t hi1 = p1 >> 32, lo1 = p1;
+            c0 = hi1 ^ c1 ^ k0;
+            c1 = lo1;
+            c2 = hi0 ^ c3 ^ k1;
+            c3 = lo0;
         }
+
+        return Block { { c0, c1, c2, c3 } };
     }
 
   private:
-    Type start, dist;
-    Type threshold = dist ? -dist % dist : dist;
-    RandomSequence* prng;
-    Type value = 0;
+    uint64_t key, stream;
+    uint64_t index = ~0ULL;
+    Block block = generate(key, stream, index >> 2);
 };
 
-class RandomDouble
+// Seeds the 64-bit generators' state words from one value, so that nearby
+// seeds still give unrelated states (Steele, Lea and Flood's SplitMix64).
+constexpr uint64_t splitmix64(uint64_t& x)
+{
+    uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+constexpr uint64_t rotl64(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+// Blackman and Vigna's xoshiro256** ("Scrambled Linear Pseudorandom Number
+// Generators", 2018): 256 bits of state, 64-bit output, period 2^256-1.
+// get() and the 32-bit fill give the high half of each output.
+class Xoshiro256 : public RandomSequence
 {
   public:
-    typedef double Type;
-    static const uint32_t mask = 0x7FFFFFFF;
+    typedef uint64_t Type;
 
-    RandomDouble() = default;
+    explicit Xoshiro256(uint64_t seed)
+    {
+        for (uint64_t& word : state) word = splitmix64(seed);
+    }
 
-    template<typename PRNG>
-    Type operator()(PRNG& prng)
+    inline Type operator()() { return value = step(state); }
+
+    virtual uint32_t get() const { return value >> 32; }
+    virtual void next() { value = step(state); }
+
+    void fill(uint64_t* out, size_t n)
+    {
+        uint64_t s[4] = { state[0], state[1], state[2], state[3] };
+        for (size_t k = 0; k < n; ++k) out[k] = step(s);
+        std::copy(s, s + 4, state);
+        if (n) value = out[n-1];
+    }
+
+    void fill(uint32_t* out, size_t n)
+    {
+        uint64_t s[4] = { state[0], state[1], state[2], state[3] };
+        for (size_t k = 0; k < n; ++k) out[k] = (value = step(s)) >> 32;
+        std::copy(s, s + 4, state);
+    }
+
+    void fill(Span<uint64_t> out) { fill(out.data, out.size); }
+    void fill(Span<uint32_t> out) { fill(out.data, out.size); }
+
+    struct State { uint64_t state[4], value; };
+
+    State save() const
+    {
+        State saved;
+        std::copy(state, state + 4, saved.state);
+        saved.value = value;
+        return saved;
+    }
+
+    void load(const State& saved)
+    {
+        std::copy(saved.state, saved.state + 4, state);
+        value = saved.value;
+    }
+
+    // Same state as 2^128 calls to next(), or 2^192 for longJump(): 2^64
+    // non-overlapping streams for parallel work, in 2^64 groups.
+    void jump()
+    {
+        static const uint64_t polynomial[4] = { 0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL,
+                                                0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL };
+        jump(polynomial);
+    }
+
+    void longJump()
+    {
+        static const uint64_t polynomial[4] = { 0x76E15D3EFEFDCBBFULL, 0xC5004E441C522FB3ULL,
+                                                0x77710069854EE241ULL, 0x39109BB02ACBE635ULL };
+        jump(polynomial);
+    }
+
+    static constexpr uint64_t step(uint64_t* s)
+    {
+        uint64_t result = rotl64(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl64(s[3], 45);
+        return result;
+    }
+
+  private:
+    // The jump polynomial evaluated at the transition: sum the states
+    // whose bits are set.
+    void jump(const uint64_t* polynomial)
     {
-        return (Type)prng() / (Type)prng.max();
+        uint64_t sum[4] = {};
+        for (int w = 0; w < 4; ++w)
+            for (int b = 0; b < 64; ++b) {
+                if (polynomial[w] >> b & 1)
+                    for (int i = 0; i < 4; ++i) sum[i] ^= state[i];
+                step(state);
+            }
+        std::copy(sum, sum + 4, state);
     }
+
+    uint64_t state[4];
+    uint64_t value = 0;
 };
 
-template <typename PRNG>
-class FisherYatesShuffler
+// xoroshiro128+ from the same paper: half the state of Xoshiro256 and a
+// cheaper step.  The low bits of each output are weak linear ones, so use
+// the high bits, as get(), the 32-bit fill and draw32() do.
+class Xoroshiro128Plus : public RandomSequence
 {
   public:
-    FisherYatesShuffler(PRNG r) : rand(r) {}
+    typedef uint64_t Type;
 
-    template <typename S, typename D>
-    void operator()(S source, D dest)
+    explicit Xoroshiro128Plus(uint64_t seed)
     {
-        for (int i = 0; i < dest.size(); ++i, source.pop()) {
-            int j = RandomUniform(0, i)(rand);
-            if (j != i) dest[i] = dest[j];
-            dest[j] = source.get();
-        }
+        for (uint64_t& word : state) word = splitmix64(seed);
     }
 
-  private:
-    PRNG rand;
-};
+    inline Type operator()() { return value = step(state); }
 
-}
+    virtual uint32_t get() const { return value >> 32; }
+    virtual void next() { value = step(state); }
+
+    void fill(uint64_t* out, size_t n)
+    {
+        uint64_t s[2] = { state[0], state[1] };
+        for (size_t k = 0; k < n; ++k) out[k] = step(s);
+        std::copy(s, s + 2, state);
+        if (n) value = out[n-1];
+    }
+
+    void fill(uint32_t* out, size_t n)
+    {
+        uint64_t s[2] = { state[0], state[1] };
+        for (size_t k = 0; k < n; ++k) out[k] = (value = step(s)) >> 32;
+        std::copy(s, s + 2, state);
+    }
+
+    void fill(Span<uint64_t> out) { fill(out.data, out.size); }
+    void fill(Span<uint32_t> out) { fill(out.data, out.size); }
+
+    struct State { uint64_t state[2], value; };
+
+    State save() const
+    {
+        State saved;
+        std::copy(state, state + 2, saved.state);
+        saved.value = value;
+        return saved;
+    }
+
+    void load(const State& saved)
+    {
+        std::copy(saved.state, saved.state + 2, state);
+        value = saved.value;
+    }
+
+    // Same state as 2^64 calls to next(), or 2^96 for longJump().
+    void jump()
+    {
+        static const uint64_t polynomial[2] = { 0xDF900294D8F554A5ULL, 0x170865DF4B3201FCULL };
+        jump(polynomial);
+    }
 
+    void longJump()
+    {
+        static const uint64_t polynomial[2] = { 0xD2A98B26625EEE7BULL, 0xDDDF9B1090AA7AC1ULL };
+        jump(polynomial);
+    }
+
+    static constexpr uint64_t step(uint64_t* s)
+    {
+        uint64_t s0 = s[0], s1 = s[1];
+        uint64_t result = s0 + s1;
+        s1 ^= s0;
+        s[0] = rotl64(s0, 24) ^ s1 ^ (s1 << 16);
+        s[1] = rotl64(s1, 37);
+        return result;
+    }
+
+  private:
+    void jump(const uint64_t* polynomial)
+    {
+        uint64_t sum[2] = {};
+        for (int w = 0; w < 2; ++w)
+            for (int b = 0; b < 64; ++b) {
+                if (polynomial[w] >> b & 1) {
+                    sum[0] ^= state[0];
+                    sum[1] ^= state[1];
+                }
+                step(state);
+            }
+        std::copy(sum, sum + 2, state);
+    }
+
+    uint64_t state[2];
+    uint64_t value = 0;
+};
+
+// O'Neill's PCG32 (XSH RR): a 64-bit LCG whose output is the high bits,
+// xorshifted and rotated by the top of the state.  Each odd increment is a
+// separate stream; advance() jumps in O(log n) like the other LCGs.
+class Pcg32 : public RandomSequence
+{
+  public:
+    typedef uint32_t Type;
+
+    explicit Pcg32(uint64_t seed, uint64_t stream = 0) :
+        increment(stream << 1 | 1)
+    {
+        state = increment + seed;
+        state = state * Multiplier + increment;
+    }
+
+    inline uint32_t operator()() { return value = step(); }
+
+    virtual uint32_t get() const { return value; }
+    virtual void next() { value = step(); }
+
+    void fill(uint32_t* out, size_t n)
+    {
+        uint64_t s = state;
+        for (size_t k = 0; k < n; ++k) {
+            out[k] = output(s);
+            s = s * Multiplier + increment;
+        }
+        state = s;
+        if (n) value = out[n-1];
+    }
+
+    void fill(Span<uint32_t> out) { fill(out.data, out.size); }
+
+    // Same state as n calls to next().
+    void advance(uint64_t n)
+    {
+        uint64_t mul = 1, add = 0;
+        uint64_t step_mul = Multiplier, step_add = increment;
+        for (; n; n >>= 1) {
+            if (n & 1) {
+                mul *= step_mul;
+                add = add * step_mul + step_add;
+            }
+            step_add *= step_mul + 1;
+            step_mul *= step_mul;
+        }
+        state = mul * state + add;
+    }
+
+    struct State { uint64_t increment, state; uint32_t value; };
+    State save() const { return { increment, state, value }; }
+
+    void load(const State& saved)
+    {
+        increment = saved.increment | 1;
+        state = saved.state;
+        value = saved.value;
+    }
+
+  private:
+    static const uint64_t Multiplier = 6364136223846793005ULL;
+
+    static constexpr uint32_t output(uint64_t s)
+    {
+        uint32_t xorshifted = ((s >> 18) ^ s) >> 27;
+        uint32_t rot = s >> 59;
+        return (xorshifted >> rot) | (xorshifted << (-rot & 31));
+    }
+
+    uint32_t step()
+    {
+        uint64_t old = state;
+        state = old * Multiplier + increment;
+        return output(old);
+    }
+
+    uint64_t increment;
+    uint64_t state;
+    uint32_t value = 0;
+};
+
+// Checkpoints as raw bytes, for files: every generator's State is a POD of
+// sizeof(typename PRNG::State) bytes.  A checkpoint only loads into the
+// same generator type, on a machine of the same byte order.
+template <typename PRNG>
+void saveState(const PRNG& prng, Span<uint8_t> bytes)
+{
+    typename PRNG::State state = prng.save();
+    kwr_require(bytes.size >= (int)sizeof state);
+    std::memcpy(bytes.data, &state, sizeof state);
+}
+
+template <typename PRNG>
+void loadState(PRNG& prng, Span<const uint8_t> bytes)
+{
+    typename PRNG::State state;
+    kwr_require(bytes.size >= (int)sizeof state);
+    std::memcpy(&state, bytes.data, sizeof state);
+    prng.load(state);
+}
+
+// Unbiased integers in [0, range) by Lemire's multiply-shift method ("Fast
+// Random Integer Generation in an Interval", 2019).  The high word of
+// r*range is the result; a divide is only needed in the rare case the low
+// word falls below range, to compute the rejection threshold.
+class RandomBounded
+{
+  public:
+    typedef uint32_t Type;
+
+    explicit RandomBounded(Type r) : range(r)
+    {
+        // Require range > 0
+    }
+
+    template <typename PRNG>
+    Type operator()(PRNG& prng) { return bounded(prng, range); }
+
+    // Batch mode: draws n raw values with prng.fill(), maps them in place
+    // and replaces the few rejected values with further draws.
+    template <typename PRNG>
+    void fill(PRNG& prng, Type* out, size_t n)
+    {
+        prng.fill(out, n);
+        Type threshold = 0;
+        bool have_threshold = false;
+
+        for (size_t k = 0; k < n; ++k) {
+            uint64_t m = (uint64_t)out[k] * range;
+            if ((Type)m < range) {
+                if (!have_threshold) {
+                    threshold = -range % range;
+                    have_threshold = true;
+                }
+                while ((Type)m < threshold)
+                    m = (uint64_t)draw32(prng) * range;
+            }
+            out[k] = m >> 32;
+        }
+    }
+
+    template <typename PRNG>
+    void fill(PRNG& prng, Span<Type> out) { fill(prng, out.data, out.size); }
+
+    template <typename PRNG>
+    static constexpr Type bounded(PRNG& prng, Type range)
+    {
+        uint64_t m = (uint64_t)draw32(prng) * range;
+        if ((Type)m < range) {
+            Type threshold = -range % range;
+            while ((Type)m < threshold)
+                m = (uint64_t)draw32(prng) * range;
+        }
+        return m >> 32;
+    }
+
+  private:
+    Type range;
+};
+
+class RandomUniform : public RandomSequence
+{
+  public:
+    typedef uint32_t Type;
+
+    RandomUniform(Type lower, Type end, RandomSequence* rnd) :
+      start(lower), dist(end - lower), prng(rnd) 
+    {
+        // Require lower < end
+    }
+
+    template <typename PRNG>
+    Type operator()(PRNG& prng) 
+    {
+        if (!dist) return start;
+        return start + RandomBounded::bounded(prng, dist);
+    }
+
+    virtual uint32_t get() const { return value; }
+
+    virtual void next()
+    {
+        if (dist) {
+            Draw draw { prng };
+            value = start + RandomBounded::bounded(draw, dist);
+        }
+    }
+
+  private:
+    struct Draw {
+        RandomSequence* sequence;
+        uint32_t operator()() { sequence->next(); return sequence->get(); }
+    };
+
+    Type start, dist;
+    RandomSequence* prng;
+    Type value = 0;
+};
+
+// Uniform [0,1) doubles built directly from random bits: the draw fills the
+// mantissa of a double in [1,2) and 1.0 is subtracted.  No divide, no need
+// for prng.max(), and every output is an exact multiple of 2^-32.
+class RandomDouble
+{
+  public:
+    typedef double Type;
+
+    RandomDouble() = default;
+
+    template<typename PRNG>
+    Type operator()(PRNG& prng) { return convert(draw32(prng)); }
+
+    // Batch mode for any generator with fill().
+    template<typename PRNG>
+    void fill(PRNG& prng, Type* out, size_t n)
+    {
+        uint32_t bits[256];
+        while (n) {
+            size_t count = std::min(n, sizeof bits / sizeof *bits);
+            prng.fill(bits, count);
+            convert(bits, out, count);
+            out += count;
+            n -= count;
+        }
+    }
+
+    static Type convert(uint32_t r)
+    {
+        uint64_t bits = 0x3FF0000000000000ULL | ((uint64_t)r << 20);
+        Type d;
+        std::memcpy(&d, &bits, sizeof d);
+        return d - 1.0;
+    }
+
+    // Branch-free loop the compiler vectorises.
+    static void convert(const uint32_t* in, Type* out, size_t n)
+    {
+        for (size_t k = 0; k < n; ++k)
+            out[k] = convert(in[k]);
+    }
+};
+
+// Uniform [0,1) floats from the top 23 bits of a draw.
+class RandomFloat
+{
+  public:
+    typedef float Type;
+
+    RandomFloat() = default;
+
+    template<typename PRNG>
+    Type operator()(PRNG& prng) { return convert(draw32(prng)); }
+
+    template<typename PRNG>
+    void fill(PRNG& prng, Type* out, size_t n)
+    {
+        uint32_t bits[256];
+        while (n) {
+            size_t count = std::min(n, sizeof bits / sizeof *bits);
+            prng.fill(bits, count);
+            convert(bits, out, count);
+            out += count;
+            n -= count;
+        }
+    }
+
+    static Type convert(uint32_t r)
+    {
+        uint32_t bits = 0x3F800000U | (r >> 9);
+        Type f;
+        std::memcpy(&f, &bits, sizeof f);
+        return f - 1.0f;
+    }
+
+    static void convert(const uint32_t* in, Type* out, size_t n)
+    {
+        for (size_t k = 0; k < n; ++k)
+            out[k] = convert(in[k]);
+    }
+};
+
+// Uniform [0,1) doubles with the full 53-bit mantissa, from two draws.
+class RandomDouble53
+{
+  public:
+    typedef double Type;
+
+    RandomDouble53() = default;
+
+    template<typename PRNG>
+    Type operator()(PRNG& prng)
+    {
+        uint32_t hi = draw32(prng);
+        uint32_t lo = draw32(prng);
+        return convert(hi, lo);
+    }
+
+    // Batch mode: consumes 2n draws, pairs taken in stream order.
+    template<typename PRNG>
+    void fill(PRNG& prng, Type* out, size_t n)
+    {
+        uint32_t bits[256];
+        while (n) {
+            size_t count = std::min(n, sizeof bits / sizeof *bits / 2);
+            prng.fill(bits, 2*count);
+            for (size_t k = 0; k < count; ++k)
+                out[k] = convert(bits[2*k], bits[2*k+1]);
+            out += count;
+            n -= count;
+        }
+    }
+
+    static Type convert(uint32_t hi, uint32_t lo)
+    {
+        uint64_t x = ((uint64_t)hi << 32 | lo) >> 11;
+        return (Type)(int64_t)x * 0x1.0p-53;
+    }
+};
+
+// Ziggurat method (Marsaglia and Tsang, 2000) for normal and exponential
+// variates.  The layer tables are computed at compile time; the common case
+// is one draw, one table lookup, one compare and one multiply.
+namespace ziggurat {
+
+// Just enough constexpr math to build the tables.
+constexpr double exp(double x)
+{
+    const double ln2 = 0.69314718055994530942;
+    long k = (long)(x / ln2 + (x < 0? -0.5: 0.5));
+    double r = x - k * ln2;
+    double term = 1, sum = 1;
+    for (int i = 1; i < 30; ++i) {
+        term *= r / i;
+        sum += term;
+    }
+    for (; k > 0; --k) sum *= 2;
+    for (; k < 0; ++k) sum /= 2;
+    return sum;
+}
+
+constexpr double log(double x)
+{
+    const double ln2 = 0.69314718055994530942;
+    int e = 0;
+    while (x >= 2) { x /= 2; ++e; }
+    while (x < 1)  { x *= 2; --e; }
+
+    // log x = 2 atanh((x-1)/(x+1))
+    double y = (x - 1) / (x + 1), y2 = y * y, term = y, sum = 0;
+    for (int i = 1; i < 60; i += 2) {
+        sum += term / i;
+        term *= y2;
+    }
+    return 2 * sum + e * ln2;
+}
+
+constexpr double sqrt(double x)
+{
+    if (x <= 0) return 0;
+    double g = x > 1? x: 1;
+    for (int i = 0; i < 100; ++i)
+        g = 0.5 * (g + x / g);
+    return g;
+}
+
+struct Tables {
+    uint32_t k[256];
+    double   w[256];
+    double   f[256];
+};
+
+// 128 layers over the normal density exp(-x^2/2).
+constexpr Tables normalTables()
+{
+    const double m1 = 2147483648.0, vn = 9.91256303526217e-3;
+    double dn = 3.442619855899, tn = dn;
+    double q = vn / exp(-0.5 * dn * dn);
+
+    Tables t {};
+    t.k[0] = (dn / q) * m1;
+    t.k[1] = 0;
+    t.w[0] = q / m1;
+    t.w[127] = dn / m1;
+    t.f[0] = 1.0;
+    t.f[127] = exp(-0.5 * dn * dn);
+
+    for (int i = 126; i >= 1; --i) {
+        dn = sqrt(-2 * log(vn / dn + exp(-0.5 * dn * dn)));
+        t.k[i+1] = (dn / tn) * m1;
+        tn = dn;
+        t.f[i] = exp(-0.5 * dn * dn);
+        t.w[i] = dn / m1;
+    }
+    return t;
+}
+
+// 256 layers over the exponential density exp(-x).
+constexpr Tables exponentialTables()
+{
+    const double m2 = 4294967296.0, ve = 3.949659822581572e-3;
+    double de = 7.697117470131487, te = de;
+    double q = ve / exp(-de);
+
+    Tables t {};
+    t.k[0] = (de / q) * m2;
+    t.k[1] = 0;
+    t.w[0] = q / m2;
+    t.w[255] = de / m2;
+    t.f[0] = 1.0;
+    t.f[255] = exp(-de);
+
+    for (int i = 254; i >= 1; --i) {
+        de = -log(ve / de + exp(-de));
+        t.k[i+1] = (de / te) * m2;
+        te = de;
+        t.f[i] = exp(-de);
+        t.w[i] = de / m2;
+    }
+    return t;
+}
+
+inline constexpr Tables normal = normalTables();
+inline constexpr Tables exponential = exponentialTables();
+
+// Open interval (0,1), safe for log().
+template <typename PRNG>
+double open(PRNG& prng) { return (draw32(prng) + 0.5) * 0x1.0p-32; }
+
+} // ziggurat
+
+class RandomNormal
+{
+  public:
+    typedef double Type;
+
+    explicit RandomNormal(double m = 0, double s = 1) : mean(m), sigma(s) {}
+
+    template <typename PRNG>
+    Type operator()(PRNG& prng) { return mean + sigma * standard(prng); }
+
+    // Batch mode: raw words come from prng.fill(); the rare values that miss
+    // the fast path finish with further direct draws.
+    template <typename PRNG>
+    void fill(PRNG& prng, Type* out, size_t n)
+    {
+        uint32_t bits[256];
+        while (n) {
+            size_t count = std::min(n, sizeof bits / sizeof *bits);
+            prng.fill(bits, count);
+            for (size_t k = 0; k < count; ++k)
+                out[k] = mean + sigma * standard(prng, bits[k]);
+            out += count;
+            n -= count;
+        }
+    }
+
+    template <typename PRNG>
+    static Type standard(PRNG& prng) { return standard(prng, draw32(prng)); }
+
+  private:
+    template <typename PRNG>
+    static Type standard(PRNG& prng, uint32_t bits)
+    {
+        const ziggurat::Tables& t = ziggurat::normal;
+        int32_t hz = bits;
+        int iz = hz & 127;
+        uint32_t magnitude = hz < 0? 0U - bits: bits;
+        if (magnitude < t.k[iz]) return hz * t.w[iz];
+
+        const double r = 3.442619855899;
+        for (;;) {
+            double x = hz * t.w[iz];
+            if (iz == 0) {
+                double y;
+                do {
+                    x = -std::log(ziggurat::open(prng)) / r;
+                    y = -std::log(ziggurat::open(prng));
+                }
+                while (y + y < x * x);
+                return hz > 0? r + x: -r - x;
+            }
+            if (t.f[iz] + ziggurat::open(prng) * (t.f[iz-1] - t.f[iz]) < std::exp(-0.5 * x * x))
+                return x;
+
+            bits = draw32(prng);
+            hz = bits;
+            iz = hz & 127;
+            magnitude = hz < 0? 0U - bits: bits;
+            if (magnitude < t.k[iz]) return hz * t.w[iz];
+        }
+    }
+
+    double mean, sigma;
+};
+
+class RandomExponential
+{
+  public:
+    typedef double Type;
+
+    explicit RandomExponential(double r = 1) : scale(1 / r) {}
+
+    template <typename PRNG>
+    Type operator()(PRNG& prng) { return scale * standard(prng); }
+
+    template <typename PRNG>
+    void fill(PRNG& prng, Type* out, size_t n)
+    {
+        uint32_t bits[256];
+        while (n) {
+            size_t count = std::min(n, sizeof bits / sizeof *bits);
+            prng.fill(bits, count);
+            for (size_t k = 0; k < count; ++k)
+                out[k] = scale * standard(prng, bits[k]);
+            out += count;
+            n -= count;
+        }
+    }
+
+    template <typename PRNG>
+    static Type standard(PRNG& prng) { return standard(prng, draw32(prng)); }
+
+  private:
+    template <typename PRNG>
+    static Type standard(PRNG& prng, uint32_t jz)
+    {
+        const ziggurat::Tables& t = ziggurat::exponential;
+        int iz = jz & 255;
+        if (jz < t.k[iz]) return jz * t.w[iz];
+
+        for (;;) {
+            if (iz == 0) return 7.697117470131487 - std::log(ziggurat::open(prng));
+
+            double x = jz * t.w[iz];
+            if (t.f[iz] + ziggurat::open(prng) * (t.f[iz-1] - t.f[iz]) < std::exp(-x))
+                return x;
+
+            jz = draw32(prng);
+            iz = jz & 255;
+            if (jz < t.k[iz]) return jz * t.w[iz];
+        }
+    }
+
+    double scale;
+};
+
+// Weighted choice of an index in [0, n) by Vose's alias method: O(n) setup
+// from the weights, then each draw is one bounded column pick and one
+// comparison against that column's threshold.
+class AliasSampler
+{
+  public:
+    typedef uint32_t Type;
+
+    AliasSampler(const double* weights, int n);
+    explicit AliasSampler(Span<const double> weights) : AliasSampler(weights.data, weights.size) {}
+
+    int size() const { return threshold.size(); }
+
+    template <typename PRNG>
+    Type operator()(PRNG& prng)
+    {
+        Type column = RandomBounded::bounded(prng, size());
+        return draw32(prng) < threshold[column]? column: alias[column];
+    }
+
+    // Batch mode: columns drawn with RandomBounded::fill, then one bulk fill
+    // of the threshold draws.
+    template <typename PRNG>
+    void fill(PRNG& prng, Type* out, size_t n)
+    {
+        uint32_t coins[256];
+        RandomBounded columns(size());
+        while (n) {
+            size_t count = std::min(n, sizeof coins / sizeof *coins);
+            columns.fill(prng, out, count);
+            prng.fill(coins, count);
+            for (size_t k = 0; k < count; ++k) {
+                Type column = out[k];
+                out[k] = coins[k] < threshold[column]? column: alias[column];
+            }
+            out += count;
+            n -= count;
+        }
+    }
+
+  private:
+    Array<uint32_t> threshold;
+    Array<uint32_t> alias;
+};
+
+template <typename PRNG>
+class FisherYatesShuffler
+{
+  public:
+    constexpr FisherYatesShuffler(PRNG r) : rand(r) {}
+
+    // Inside-out shuffle of source into dest.
+    template <typename S, typename D>
+    void operator()(S source, D dest)
+    {
+        for (int i = 0; i < dest.size(); ++i, source.pop()) {
+            int j = RandomBounded::bounded(rand, i + 1);
+            if (j != i) dest[i] = dest[j];
+            dest[j] = source.get();
+        }
+    }
+
+    // In-place shuffle; usable in constant expressions with a literal-type
+    // engine such as MinstdEngine.
+    template <typename T>
+    constexpr void shuffle(T* data, size_t n)
+    {
+        for (size_t i = n; i > 1; --i) {
+            size_t j = RandomBounded::bounded(rand, i);
+            T t = data[i-1];
+            data[i-1] = data[j];
+            data[j] = t;
+        }
+    }
+
+  private:
+    PRNG rand;
+};
+
+// Parallel MergeShuffle (Bacher, Bodini, Hollender and Lumbroso, 2015).
+// The array is cut into a power-of-two number of blocks, each block is
+// Fisher-Yates shuffled on its own thread, then neighbouring blocks are
+// merged pairwise, level by level, by a random riffle that preserves
+// uniformity.  Every block and every merge draws from its own Philox
+// stream, so the result depends only on the seed and the block count, which
+// is fixed by the pool size.
+class MergeShuffler
+{
+  public:
+    MergeShuffler(uint64_t s, ThreadPool& p) : seed(s), pool(p) {}
+
+    template <typename T>
+    void operator()(Array<T>& array) { (*this)(Span<T>{ array.size(), &array[0] }); }
+
+    template <typename T>
+    void operator()(Span<T> data)
+    {
+        int blocks = 1;
+        while (blocks < 4 * pool.size() && data.size / (2 * blocks) >= MinBlock)
+            blocks *= 2;
+
+        pool.run(blocks, [&](int b) {
+            Philox prng(seed, b);
+            FisherYatesShuffler<Philox> shuffler(prng);
+            shuffler.shuffle(data.data + start(data, blocks, b), start(data, blocks, b+1) - start(data, blocks, b));
+        });
+
+        for (int width = 1, level = 1; width < blocks; width *= 2, ++level) {
+            pool.run(blocks / (2 * width), [&](int pair) {
+                Philox prng(seed, (uint64_t)level << 32 | pair);
+                int first = 2 * pair * width;
+                int begin = start(data, blocks, first);
+                int middle = start(data, blocks, first + width);
+                int end = start(data, blocks, first + 2 * width);
+                merge(data.data + begin, middle - begin, end - middle, prng);
+            });
+        }
+    }
+
+  private:
+    static const int MinBlock = 1 << 12;
+
+    template <typename T>
+    static int start(Span<T> data, int blocks, int b) { return (int64_t)data.size * b / blocks; }
+
+    // Riffle two shuffled runs a[0,n1) and a[n1,n1+n2): take from either run
+    // by coin flip until one runs out, then insert the remainder with
+    // Fisher-Yates steps.
+    template <typename T, typename PRNG>
+    static void merge(T* a, size_t n1, size_t n2, PRNG& prng)
+    {
+        size_t i = 0, j = n1, n = n1 + n2;
+        uint32_t bits = 0;
+        int left = 0;
+
+        for (;;) {
+            if (!left) {
+                bits = draw32(prng);
+                left = 32;
+            }
+            bool flip = bits & 1;
+            bits >>= 1;
+            --left;
+
+            if (flip) {
+                if (j == n) break;
+                std::swap(a[i], a[j]);
+                ++j;
+            }
+            else if (i == j) {
+                break;
+            }
+            ++i;
+        }
+
+        for (; i < n; ++i)
+            std::swap(a[i], a[RandomBounded::bounded(prng, i + 1)]);
+    }
+
+    uint64_t seed;
+    ThreadPool& pool;
+};
+
+// k distinct indices from [0, n) by Floyd's algorithm: one bounded draw per
+// index and an open-addressed set of k entries, however large n is.  Every
+// k-subset is equally likely, but the order indices are written in is not
+// uniform; shuffle the result if order matters.
+class RandomSubset
+{
+  public:
+    typedef uint32_t Type;
+
+    explicit RandomSubset(int k) : slots(tableSize(k)) {}
+
+    template <typename PRNG>
+    void operator()(PRNG& prng, uint32_t n, Type* out, int k)
+    {
+        kwr_require(k >= 0 && (uint32_t)k <= n && tableSize(k) <= slots.size());
+        const uint32_t mask = slots.size() - 1;
+        std::fill(&slots[0], &slots[0] + slots.size(), Empty);
+
+        int count = 0;
+        for (uint32_t j = n - k; j < n; ++j) {
+            uint32_t t = RandomBounded::bounded(prng, j + 1);
+            if (!insert(t, mask)) {
+                t = j;
+                insert(t, mask);
+            }
+            out[count++] = t;
+        }
+    }
+
+    template <typename PRNG>
+    void operator()(PRNG& prng, uint32_t n, Span<Type> out) { (*this)(prng, n, out.data, out.size); }
+
+  private:
+    static constexpr uint32_t Empty = 0xFFFFFFFFU;
+
+    // Power of two at least twice k, so probes stay short.
+    static int tableSize(int k)
+    {
+        int size = 2;
+        while (size < 2*k) size *= 2;
+        return size;
+    }
+
+    // False if value was already present.
+    bool insert(uint32_t value, uint32_t mask)
+    {
+        uint32_t slot = hash32(value) & mask;
+        for (; slots[slot] != Empty; slot = (slot + 1) & mask)
+            if (slots[slot] == value) return false;
+        slots[slot] = value;
+        return true;
+    }
+
+    Array<uint32_t> slots;
+};
+
+// The integers 0, 1, ..., n-1 as a sequence, for sampling indices.
+class CountingSequence {
+  public:
+    explicit CountingSequence(int n) : end(n) {}
+    int  get() const  { return count; }
+    void next()       { ++count; }
+    bool more() const { return count < end; }
+
+  private:
+    int count = 0, end;
+};
+
+// Uniform sample of up to reservoir.size items from a sequence of unknown
+// length, in one pass and O(k) memory.  Li's Algorithm L draws how many items
+// to skip, so random numbers are only consumed when the reservoir changes.
+// The sequence needs next(), more() and a get() convertible to T.
+template <typename T>
+class ReservoirSampler
+{
+  public:
+    explicit ReservoirSampler(Span<T> r) : reservoir(r) {}
+
+    // Returns how many items were kept: all of them when the sequence is
+    // shorter than the reservoir.
+    template <typename PRNG, typename S>
+    int operator()(PRNG& prng, S& sequence)
+    {
+        const int k = reservoir.size;
+        int count = 0;
+        for (; count < k && sequence.more(); sequence.next())
+            reservoir.data[count++] = sequence.get();
+        if (count < k || k == 0) return count;
+
+        double w = std::exp(std::log(open(prng)) / k);
+        while (true) {
+            double skip = std::floor(std::log(open(prng)) / std::log1p(-w));
+            for (; skip > 0 && sequence.more(); skip -= 1) sequence.next();
+            if (!sequence.more()) return k;
+
+            reservoir.data[RandomBounded::bounded(prng, k)] = sequence.get();
+            sequence.next();
+            w *= std::exp(std::log(open(prng)) / k);
+        }
+    }
+
+  private:
+    // Uniform on (0, 1) with 53 bits, so log() never sees zero.
+    template <typename PRNG>
+    static double open(PRNG& prng)
+    {
+        uint32_t hi = draw32(prng);
+        uint32_t lo = draw32(prng);
+        return RandomDouble53::convert(hi, lo) + 0x1.0p-54;
+    }
+
+    Span<T> reservoir;
+};
+
+// Compile-time tables, e.g.
+//   static constexpr auto perm = permutationTable<256>(MinstdEngine(seed));
+
+template <size_t N, typename PRNG>
+constexpr std::array<uint32_t, N> permutationTable(PRNG prng)
+{
+    std::array<uint32_t, N> table {};
+    for (size_t i = 0; i < N; ++i) table[i] = i;
+    FisherYatesShuffler<PRNG> shuffler(prng);
+    shuffler.shuffle(table.data(), N);
+    return table;
+}
+
+// Same values as RandomDouble, computed without the bit copy so it is
+// usable in constant expressions.
+template <size_t N, typename PRNG>
+constexpr std::array<double, N> uniformTable(PRNG prng)
+{
+    std::array<double, N> table {};
+    for (size_t i = 0; i < N; ++i) table[i] = draw32(prng) * 0x1.0p-32;
+    return table;
+}
+
+}
@@ -69,7 +69,8 @@ BitmapSurface::~BitmapSurface() throw()
 
 
 Renderer::Renderer(Window& window) : 
-  renderer( SDL_CreateRenderer(window.get(), -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC) ),
+  renderer( SDL_CreateRenderer(window.get(), -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC |
+                                                SDL_RENDERER_TARGETTEXTURE) ),
   color(*this)
 {
     check(renderer);
@@ -130,6 +131,35 @@ void Renderer::present()
     SDL_RenderPresent(renderer);
 }
 
+void Renderer::drawLines(Span<const SDL_Point> points)
+{
+    check( SDL_RenderDrawLines(renderer, points.data, points.size) );
+}
+
+// SDL2 has no call for separate lines, but it queues draws until present,
+// so each line only adds to the queue; errors are checked once.
+void Renderer::drawSegments(Span<const SDL_Point> ends)
+{
+    kwr_require(ends.size % 2 == 0);
+    int failed = 0;
+    for (int k = 0; k < ends.size; k += 2) {
+        const SDL_Point& p1 = ends.data[k];
+        const SDL_Point& p2 = ends.data[k+1];
+        failed |= SDL_RenderDrawLine(renderer, p1.x, p1.y, p2.x, p2.y);
+    }
+    check(failed);
+}
+
+void Renderer::drawRects(Span<const SDL_Rect> rects)
+{
+    check( SDL_RenderDrawRects(renderer, rects.data, rects.size) );
+}
+
+void Renderer::fillRects(Span<const SDL_Rect> rects)
+{
+    check( SDL_RenderFillRects(renderer, rects.data, rects.size) );
+}
+
 SDL_Texture* Renderer::textureFrom(Surface& surface)
 {
     SDL_Texture* tex = SDL_CreateTextureFromSurface(renderer, surface.get());
@@ -137,6 +167,25 @@ SDL_Texture* Renderer::textureFrom(Surface& surface)
     return tex;
 }
 
+SDL_Texture* Renderer::targetTexture(Dims size)
+{
+    SDL_Texture* tex = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                                         SDL_TEXTUREACCESS_TARGET, size.width, size.height);
+    check(tex);
+    check( SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND) );
+    return tex;
+}
+
+void Renderer::renderTo(Texture& tex)
+{
+    check( SDL_SetRenderTarget(renderer, tex.get()) );
+}
+
+void Renderer::renderToWindow()
+{
+    check( SDL_SetRenderTarget(renderer, nullptr) );
+}
+
 Renderer::~Renderer() throw()
 {
     SDL_DestroyRenderer(renderer);
@@ -154,6 +203,12 @@ Texture::~Texture()
     SDL_DestroyTexture(texture);
 }
 
+void Texture::reset(SDL_Texture* tex)
+{
+    if (texture) SDL_DestroyTexture(texture);
+    texture = tex;
+}
+
 Dims Texture::size() 
 {
     Dims result;
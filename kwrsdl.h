@@ -71,10 +71,12 @@ class Texture : public Object {
     Texture() = default;
     Texture(SDL_Texture* tex);
     SDL_Texture* get() { return texture; }
+    bool empty() const { return texture == nullptr; }
     Dims size();
+    void reset(SDL_Texture* tex);
     ~Texture() throw();
 
-    /// TODO: swap, move, dispose, reset, release
+    /// TODO: swap, move, dispose, release
 
   private:
     SDL_Texture* texture = nullptr;
@@ -108,8 +110,24 @@ class Renderer : public Object {
     void fill(SDL_Rect rect);
     void present();
 
+    // Many shapes from one array.  drawLines() joins each point to the next
+    // and, like the rectangle calls, is one SDL call.  drawSegments() joins
+    // points 0-1, 2-3, and so on, queueing one line at a time, and needs an
+    // even number of points.
+    void drawLines(Span<const SDL_Point> points);
+    void drawSegments(Span<const SDL_Point> ends);
+    void drawRects(Span<const SDL_Rect> rects);
+    void fillRects(Span<const SDL_Rect> rects);
+
     SDL_Texture* textureFrom(Surface& surface);
 
+    // A transparent texture to draw into, for pictures that are drawn once
+    // and copied every frame.  Drawing goes to it between renderTo() and
+    // renderToWindow().
+    SDL_Texture* targetTexture(Dims size);
+    void renderTo(Texture& tex);
+    void renderToWindow();
+
     ~Renderer();
 
     /// TODO: swap, move, dispose, reset, release
@@ -0,0 +1,414 @@
+#ifndef KWR_HEADER_KWRSOLVER_H
+#define KWR_HEADER_KWRSOLVER_H
+
+#include <cstdint>
+#include <cstring>
+#include <climits>
+#include <cstdlib>
+#include <algorithm>
+#include "kwrlib.h"
+#include "kwrmaze.h"
+
+namespace kwr {
+
+// Min-heap of cells by key, with four children per node: half the depth
+// of a binary heap.  The entries are 64-byte aligned and the root sits at
+// index 3, so the children of node k are 4(k-2) to 4(k-2)+3 and every
+// sibling group fills half of one cache line.  Each cell's place is
+// tracked, so pushing a cell already in the heap lowers its key in place.
+// Holds each cell at most once, so it is sized once for a grid.
+class CellHeap {
+  public:
+    explicit CellHeap(int cells) :
+      place(cells), lines((Root + cells + LineEntries - 1) / LineEntries), entries(lines[0].entry)
+    {
+        std::fill(&place[0], &place[0] + place.size(), -1);
+    }
+
+    bool empty() const { return end == Root; }
+
+    // Adds cell with key, or lowers its key if that is less.
+    void push(int cell, uint32_t key)
+    {
+        int k = place[cell];
+        if (k < 0) k = end++;
+        else if (key >= entries[k].key) return;
+        siftUp(k, { key, cell });
+    }
+
+    // Removes and returns the cell with the least key.
+    int pop()
+    {
+        int top = entries[Root].cell;
+        place[top] = -1;
+        if (--end > Root) siftDown(Root, entries[end]);
+        return top;
+    }
+
+    // Empties the heap in time proportional to what is left in it.
+    void clear()
+    {
+        while (end > Root) place[entries[--end].cell] = -1;
+    }
+
+  private:
+    struct Entry {
+        uint32_t key;
+        int cell;
+    };
+
+    static const int LineEntries = 64 / sizeof(Entry);
+    struct alignas(64) Line { Entry entry[LineEntries]; };
+
+    static const int Root = 3;
+    static int parent(int k) { return k / 4 + 2; }
+    static int firstChild(int k) { return 4 * (k - 2); }
+
+    void siftUp(int k, Entry entry)
+    {
+        while (k > Root) {
+            int up = parent(k);
+            if (entries[up].key <= entry.key) break;
+            put(k, entries[up]);
+            k = up;
+        }
+        put(k, entry);
+    }
+
+    void siftDown(int k, Entry entry)
+    {
+        for (int first = firstChild(k); first < end; first = firstChild(k)) {
+            int least = first, last = std::min(first + 4, end);
+            for (int child = first + 1; child < last; ++child)
+                if (entries[child].key < entries[least].key) least = child;
+            if (entries[least].key >= entry.key) break;
+            put(k, entries[least]);
+            k = least;
+        }
+        put(k, entry);
+    }
+
+    void put(int k, Entry entry)
+    {
+        entries[k] = entry;
+        place[entry.cell] = k;
+    }
+
+    Array<int> place;
+    Array<Line> lines;
+    Entry* entries;
+    int end = Root;
+};
+
+// Shortest paths through a maze's passages by breadth-first search, and
+// cheapest paths through weighted cells by Dijkstra's algorithm and A*.  The
+// solver copies each cell's passages() into a byte, so searches touch no
+// grid, and allocates its arrays once and reuses them for every search:
+// nothing is allocated per cell or per query.  Paths are views into the
+// solver, valid until its next search.
+//
+// Searching a large maze is bound by memory latency, so the search keeps
+// its state in the same byte as the passages it has to load anyway.
+template <typename Grid>
+class MazeSolver {
+  public:
+    explicit MazeSolver(const Grid& maze) :
+      columns(maze.columns), cells(maze.size()), depth(maze.size()), queue(maze.size())
+    {
+        step[North] = -maze.columns;
+        step[East]  = 1;
+        step[West]  = -1;
+        step[South] = maze.columns;
+        update(maze);
+    }
+
+    // Takes the maze's passages again after it has changed.
+    void update(const Grid& maze)
+    {
+        for (int i = 0; i < maze.size(); ++i) cells[i] = maze.passages(i);
+    }
+
+    // Distances from source to every cell, -1 where there is no way
+    // through, for distance() and path().  Returns the farthest cell.
+    int fill(int source) { return queue[search(source) - 1]; }
+
+    int distance(int cell) const { return depth[cell]; }
+    Span<const int> distances() const { return { depth.size(), &depth[0] }; }
+
+    // The cells from fill()'s source to target, source first; empty if
+    // target cannot be reached.
+    Span<const int> path(int target)
+    {
+        int length = depth[target] + 1;
+        int cell = target;
+        for (int k = length - 1; k >= 0; --k) {
+            queue[k] = cell;
+            cell = parent(cell);
+        }
+        return { length, &queue[0] };
+    }
+
+    // The longest path of a perfect maze.  One fill() from cell 0; then,
+    // deepest cells first, each cell hands its longest branch down to its
+    // parent, and the longest path is the longest pair of branches that
+    // meet at a cell.  Leaves cell 0's distances.
+    Span<const int> longestPath()
+    {
+        int count = search(0);
+
+        // Each cell's longest branch: its length above the leaf it ends at.
+        Array<uint64_t>& branch = marks();
+        for (int i = 0; i < branch.size(); ++i) branch[i] = (uint32_t)i;
+
+        int longest = 0, first = 0, last = 0;
+        for (int k = count - 1; k > 0; --k) {
+            int cell = queue[k], up = parent(cell);
+            uint64_t down = branch[cell] + ((uint64_t)1 << 32);
+            int length = (down >> 32) + (branch[up] >> 32);
+            if (length > longest) {
+                longest = length;
+                first = (uint32_t)down;
+                last = (uint32_t)branch[up];
+            }
+            branch[up] = std::max(branch[up], down);
+        }
+        std::memset(&branch[0], 0, sizeof(uint64_t) * branch.size());
+        searches = 0;
+
+        // Up from both ends to where they meet, first's half from the front.
+        int front = 0, back = longest;
+        while (first != last) {
+            if (depth[first] >= depth[last]) {
+                queue[front++] = first;
+                first = parent(first);
+            }
+            else {
+                queue[back--] = last;
+                last = parent(last);
+            }
+        }
+        queue[front] = first;
+        return { longest + 1, &queue[0] };
+    }
+
+    // The shortest path from source to target, source first, or empty if
+    // there is none.  Searches from both ends a level at a time, expanding
+    // the smaller frontier, and stops after the level where they meet.
+    // Cells are marked with the search's stamp and their depth, so nothing
+    // is cleared between queries; distance() is left alone.
+    Span<const int> solve(int source, int target)
+    {
+        newSearch();
+
+        // Side 0 searches from the source and queues from the front of the
+        // queue; side 1 from the target, queueing from the back.
+        const uint32_t stamp[2] = { 2*searches, 2*searches + 1 };
+        int head[2] = { 0, 0 }, tail[2] = { 1, 1 }, level[2] = { 0, 0 };
+        mark[source] = (uint64_t)stamp[0] << 32;
+        mark[target] = (uint64_t)stamp[1] << 32;
+        queued(0, 0) = source;
+        queued(1, 0) = target;
+
+        int best = INT_MAX, from_source = -1, from_target = -1;
+        while (source != target && head[0] < tail[0] && head[1] < tail[1]) {
+            int side = tail[0] - head[0] <= tail[1] - head[1]? 0: 1;
+            uint32_t own = stamp[side], other = stamp[1 - side];
+            for (int end = tail[side]; head[side] < end; ) {
+                int cell = queued(side, head[side]++);
+                unsigned open = cells[cell] & Passages;
+                for (int d = 0; d < 4; ++d) {
+                    if (!(open >> d & 1)) continue;
+                    int next = cell + step[d];
+                    uint32_t seen = mark[next] >> 32;
+                    if (seen == other) {
+                        int length = level[side] + 1 + (uint32_t)mark[next];
+                        if (length < best) {
+                            best = length;
+                            from_source = side? next: cell;
+                            from_target = side? cell: next;
+                        }
+                    }
+                    else if (seen != own) {
+                        mark[next] = (uint64_t)own << 32 | (level[side] + 1);
+                        queued(side, tail[side]++) = next;
+                    }
+                }
+            }
+            ++level[side];
+            if (best < INT_MAX) break;
+        }
+
+        if (source == target) {
+            queue[0] = source;
+            return { 1, &queue[0] };
+        }
+        if (best == INT_MAX) return {};
+
+        int middle = (uint32_t)mark[from_source];
+        int cell = from_source;
+        for (int k = middle; k >= 0; --k) {
+            queue[k] = cell;
+            cell = back(cell, stamp[0]);
+        }
+        cell = from_target;
+        for (int k = middle + 1; k <= best; ++k) {
+            queue[k] = cell;
+            cell = back(cell, stamp[1]);
+        }
+        return { best + 1, &queue[0] };
+    }
+
+    // Cell costs for dijkstra() and astar(), copied: entering a cell costs
+    // its cost, so a path costs the sum over its cells after the first.
+    // Path costs must fit in 32 bits.
+    void weigh(Span<const uint32_t> costs)
+    {
+        kwr_require(costs.size == depth.size());
+        if (heap.empty()) {
+            heap.reset(new CellHeap(depth.size()));
+            Array<uint32_t>(depth.size()).swap(cost);
+        }
+        std::copy(costs.data, costs.data + costs.size, &cost[0]);
+        cheapest = *std::min_element(costs.data, costs.data + costs.size);
+    }
+
+    // The cheapest path from source to target, source first, or empty if
+    // there is none; pathCost() is its cost.  Cells are stamped with the
+    // search and their cost so far, as in solve(), and the heap is emptied
+    // as it goes, so queries allocate and clear nothing.  Both overwrite
+    // the directions that path() follows.
+    Span<const int> dijkstra(int source, int target) { return cheapestPath(source, target, false); }
+
+    // Dijkstra's algorithm guided towards target by the Manhattan distance
+    // times the cheapest cell, which never overestimates, so the path is
+    // still the cheapest.
+    Span<const int> astar(int source, int target) { return cheapestPath(source, target, true); }
+
+    uint32_t pathCost() const { return path_cost; }
+
+  private:
+    // Breadth-first from source, level by level, setting depth and each
+    // cell's parent.  Returns the number of cells reached, which are the
+    // front of the queue in order of distance.
+    int search(int source)
+    {
+        std::fill(&depth[0], &depth[0] + depth.size(), -1);
+        for (int i = 0; i < cells.size(); ++i) cells[i] &= Passages;
+        cells[source] |= Reached;
+        depth[source] = 0;
+        queue[0] = source;
+        int head = 0, tail = 1;
+        for (int level = 1; head < tail; ++level) {
+            for (int end = tail; head < end; ) {
+                int cell = queue[head++];
+                unsigned open = cells[cell] & Passages;
+                for (int d = 0; d < 4; ++d) {
+                    int next = cell + step[d];
+                    if (open >> d & 1 && !(cells[next] & Reached)) {
+                        cells[next] |= Reached | opposite(d) << ParentShift;
+                        depth[next] = level;
+                        queue[tail++] = next;
+                    }
+                }
+            }
+        }
+        return tail;
+    }
+
+    int parent(int cell) const { return cell + step[cells[cell] >> ParentShift & 3]; }
+
+    // A new search number, whose stamps are 2*searches and 2*searches + 1.
+    void newSearch()
+    {
+        marks();
+        if (searches == UINT32_MAX / 2) {
+            std::memset(&mark[0], 0, sizeof(uint64_t) * mark.size());
+            searches = 0;
+        }
+        ++searches;
+    }
+
+    Span<const int> cheapestPath(int source, int target, bool guided)
+    {
+        kwr_require(!heap.empty());
+        newSearch();
+        const uint64_t stamp = (uint64_t)(2*searches) << 32;
+        const int target_row = target / columns, target_column = target % columns;
+        const int row_step[4] = { -1, 0, 0, 1 }, column_step[4] = { 0, 1, -1, 0 };
+        auto estimate = [&](int row, int column) {
+            if (!guided) return 0U;
+            return (uint32_t)(std::abs(row - target_row) + std::abs(column - target_column)) * cheapest;
+        };
+
+        heap->clear();
+        mark[source] = stamp;
+        heap->push(source, estimate(source / columns, source % columns));
+        while (!heap->empty()) {
+            int cell = heap->pop();
+            uint32_t so_far = (uint32_t)mark[cell];
+            if (cell == target) {
+                path_cost = so_far;
+                int k = queue.size();
+                for (queue[--k] = cell; cell != source; queue[--k] = cell)
+                    cell = parent(cell);
+                return { queue.size() - k, &queue[k] };
+            }
+
+            int row = cell / columns, column = cell - row*columns;
+            unsigned open = cells[cell] & Passages;
+            for (int d = 0; d < 4; ++d) {
+                if (!(open >> d & 1)) continue;
+                int next = cell + step[d];
+                uint64_t through = stamp | (so_far + cost[next]);
+                if ((mark[next] & ~(uint64_t)UINT32_MAX) != stamp || through < mark[next]) {
+                    mark[next] = through;
+                    cells[next] = (cells[next] & Passages) | opposite(d) << ParentShift;
+                    heap->push(next, (uint32_t)through + estimate(row + row_step[d], column + column_step[d]));
+                }
+            }
+        }
+        path_cost = 0;
+        return {};
+    }
+
+    // Marks for solve() and the weighted searches, allocated on first use.
+    Array<uint64_t>& marks()
+    {
+        if (mark.empty()) {
+            Array<uint64_t> fresh(depth.size());
+            std::memset(&fresh[0], 0, sizeof(uint64_t) * fresh.size());
+            mark.swap(fresh);
+        }
+        return mark;
+    }
+
+    int& queued(int side, int k) { return queue[side? queue.size() - 1 - k: k]; }
+
+    // The neighbour one step nearer the start of the search with this stamp.
+    int back(int cell, uint32_t stamp) const
+    {
+        uint64_t previous = (uint64_t)stamp << 32 | ((uint32_t)mark[cell] - 1);
+        unsigned open = cells[cell] & Passages;
+        for (int d = 0; d < 4; ++d)
+            if (open >> d & 1 && mark[cell + step[d]] == previous) return cell + step[d];
+        return -1;
+    }
+
+    // Each cell's passages() in the low bits, then whether search() has
+    // reached it and the direction it came from.
+    enum { Passages = 15, Reached = 16, ParentShift = 5 };
+
+    int columns, step[4];
+    Array<uint8_t> cells;
+    Array<int> depth, queue;
+    Array<uint64_t> mark;
+    uint32_t searches = 0;
+
+    Handle<CellHeap> heap;
+    Array<uint32_t> cost;
+    uint32_t cheapest = 0, path_cost = 0;
+};
+
+} // kwr
+
+#endif
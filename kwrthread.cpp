@@ -0,0 +1,75 @@
+#include "kwrthread.h"
+
+namespace kwr {
+
+ThreadPool::ThreadPool(int threads) :
+  workers(std::max(threads, 1) - 1)
+{
+    for (int i = 0; i < workers.size(); ++i)
+        workers[i] = std::thread(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (int i = 0; i < workers.size(); ++i)
+        workers[i].join();
+}
+
+void ThreadPool::run(int tasks, const std::function<void(int)>& task)
+{
+    if (tasks <= 0) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &task;
+        count = tasks;
+        taken = 0;
+        pending = tasks;
+        ++generation;
+    }
+    wake.notify_all();
+
+    drain();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]{ return pending == 0; });
+    job = nullptr;
+}
+
+void ThreadPool::work()
+{
+    unsigned seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]{ return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        drain();
+    }
+}
+
+// Take and run tasks until none are left in the current job.
+void ThreadPool::drain()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (taken < count) {
+        int index = taken++;
+        const std::function<void(int)>& task = *job;
+        lock.unlock();
+
+        task(index);
+
+        lock.lock();
+        if (--pending == 0) done.notify_all();
+    }
+}
+
+} // kwr namespace
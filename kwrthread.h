@@ -0,0 +1,40 @@
+#ifndef KWR_HEADER_KWRTHREAD_H
+#define KWR_HEADER_KWRTHREAD_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "kwrlib.h"
+
+namespace kwr {
+
+// Fixed set of worker threads.  run() hands task indices 0..tasks-1 to the
+// workers and to the calling thread, and returns when every task is done.
+class ThreadPool : public Object {
+  public:
+    explicit ThreadPool(int threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    // Threads that execute tasks, including the caller of run().
+    int size() const { return workers.size() + 1; }
+
+    void run(int tasks, const std::function<void(int)>& task);
+
+  private:
+    void work();
+    void drain();
+
+    Array<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+
+    const std::function<void(int)>* job = nullptr;
+    int count = 0, taken = 0, pending = 0;
+    unsigned generation = 0;
+    bool stopping = false;
+};
+
+} // kwr namespace
+
+#endif
@@ -4,114 +4,106 @@
 #include "kwrerr.h"
 #include "kwrlegocolors.h"
 #include "kwrprng.h"
+#include "kwrmaze.h"
 
 namespace kwr {
 using namespace kwr::game;
 
-class Cell;
-
-class CellLink {
+// Draws any grid with the kwrmaze.h interface, e.g.
+//   MazeWindow mazewin(&maze);
+// The walls are drawn once into a texture the size of the window, which
+// each frame copies to the window.  Call invalidate() after changing the
+// maze to draw them again.
+template <typename Grid>
+class MazeWindow : public GameDriver {
   public:
-    Cell* link = nullptr;
-    bool  open = false;
-};
-
-const int North = 0;
-const int East  = 1;
-const int West  = 2;
-const int South = 3;
+    MazeWindow(Grid* m) : 
+      GameDriver( {800, 800}, LegoColors::Black, "Maze"),
+      maze(m)
+    {}
 
-class Cell
-{
-  public:
-    void init(int r, int c) { row = r; column = c; }
+    void invalidate() { stale = true; }
 
-    void link(Cell* cell, bool bidi = true)
+    void handle(const SDL_Event& event) override
     {
-        if (!cell) return;
-        for (int i = 0; i < 4; ++i) {
-            if (links[i].link == cell) {
-                links[i].open = true;
-                break;
-            }
+        // Render targets lose their pixels when the targets are reset, and
+        // every texture must be made again when the device is.
+        if (event.type == SDL_RENDER_DEVICE_RESET) {
+            walls.reset(nullptr);
+            invalidate();
         }
-        if (bidi) cell->link(this, false);
+        if (event.type == SDL_RENDER_TARGETS_RESET)
+            invalidate();
+        if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+            invalidate();
+        GameDriver::handle(event);
     }
 
-    int row, column;
-    CellLink links[4];
-};
-
-class MazeGrid {
-  public:
-    MazeGrid(int rs, int cs) : 
-      rows(rs), columns(cs), cells(rows*columns)
-    {
-        prepare();
-        configure();
-    }
-
-    void prepare()
+    void render() override
     {
-        for (int r = 0; r < rows; ++r) {
-            for (int c = 0; c < columns; ++c) {
-                get(r, c)->init(r, c); 
-            }
-        }    
+        if (stale) drawWalls();
+        renderer.draw(walls, {0, 0});
     }
-
-    void configure()
+    
+  private:
+    void drawWalls()
     {
-        for (int i = 0; i < cells.size(); ++i) {
-            Cell& cell = cells[i];
-            cell.links[North].link = get(cell.row-1, cell.column);
-            cell.links[South].link = get(cell.row+1, cell.column);
-            cell.links[West].link  = get(cell.row,   cell.column-1);
-            cell.links[East].link  = get(cell.row,   cell.column+1);
+        Dims size = renderer.size();
+        if (!walls.empty()) {
+            Dims made = walls.size();
+            if (made.width != size.width || made.height != size.height) walls.reset(nullptr);
         }
-    }
+        if (walls.empty()) walls.reset(renderer.targetTexture(size));
+        renderer.renderTo(walls);
+        renderer.color = SDL_Color{0, 0, 0, 0};
+        renderer.clear();
 
-    Cell* get(int r, int c)
-    {
-        if (r < 0 || r >= rows) return nullptr;
-        if (c < 0 || c >= columns) return nullptr;
-        return &cells[r*columns + c];
-    }
-
-    int rows, columns;
-    Array<Cell> cells;
-};
-
-class MazeWindow : public GameDriver {
-  public:
-    MazeWindow(MazeGrid* m) : 
-      GameDriver( {800, 800}, LegoColors::Black, "Maze"),
-      maze(m)
-    {}
-
-    void render() override
-    {
         int cell_size = 750 / maze->rows;
         int margin = 25;
         SDL_Color wall_color = LegoColors::White;
         renderer.color = wall_color;
 
-        for (int i = 0; i < maze->cells.size(); ++i) {
-            Cell& cell = maze->cells[i];
-            int x1 = cell.column * cell_size + margin;
-            int y1 = cell.row * cell_size + margin;
-            int x2 = (cell.column+1) * cell_size + margin;
-            int y2 = (cell.row+1) * cell_size + margin;
-
-            if (cell.row == 0) renderer.draw({x1,y1}, {x2,y1});
-            if (cell.column == 0) renderer.draw({x1,y1}, {x1,y2});
-            if (!cell.links[East].open)   renderer.draw({x2,y1}, {x2,y2});
-            if (!cell.links[South].open)  renderer.draw({x1,y2}, {x2,y2});
+        // Each straight run of walls is one segment: the runs along each
+        // line between rows, then along each line between columns.
+        const int rows = maze->rows, columns = maze->columns;
+        auto closed_above = [&](int r, int c) { return r == 0 || r == rows || !maze->open((r-1)*columns + c, South); };
+        auto closed_left  = [&](int r, int c) { return c == 0 || c == columns || !maze->open(r*columns + c-1, East); };
+        auto x = [&](int c) { return c * cell_size + margin; };
+        auto y = [&](int r) { return r * cell_size + margin; };
+
+        Array<SDL_Point> ends(2 * ((rows+1) * columns + (columns+1) * rows));
+        int count = 0;
+        for (int r = 0; r <= rows; ++r) {
+            for (int c = 0, start = -1; c <= columns; ++c) {
+                bool wall = c < columns && closed_above(r, c);
+                if (wall && start < 0) start = c;
+                if (!wall && start >= 0) {
+                    ends[count++] = {x(start), y(r)};
+                    ends[count++] = {x(c), y(r)};
+                    start = -1;
+                }
+            }
+        }
+        for (int c = 0; c <= columns; ++c) {
+            for (int r = 0, start = -1; r <= rows; ++r) {
+                bool wall = r < rows && closed_left(r, c);
+                if (wall && start < 0) start = r;
+                if (!wall && start >= 0) {
+                    ends[count++] = {x(c), y(start)};
+                    ends[count++] = {x(c), y(r)};
+                    start = -1;
+                }
+            }
         }
+        renderer.drawSegments({count, &ends[0]});
+
+        renderer.renderToWindow();
+        stale = false;
     }
-    
-  private:
-    MazeGrid* maze;
+
+    Grid* maze;
+    Texture walls;
+    bool stale = true;
 };
 
 } // kwr
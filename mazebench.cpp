@@ -0,0 +1,278 @@
+#include "kwrlib.h"
+#include "kwrmaze.h"
+#include "kwrsolver.h"
+#include <chrono>
+#include <thread>
+#include <cmath>
+
+using namespace kwr;
+
+// Headless maze generation benchmark, in cells per second.
+//
+// Each generator runs once sequentially and then in parallel on pools of
+// 1, 2, 4, ... threads up to the hardware count.  The parallel mazes must
+// not depend on the thread count, so each is checked against the 1-thread
+// result.
+
+static const int Rows = 4096;
+static const int Columns = 4096;
+
+class Stopwatch {
+  public:
+    double seconds() const
+    {
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        return elapsed.count();
+    }
+
+  private:
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+};
+
+void report(CString name, CString grid, int threads, const Stopwatch& timer, int cells)
+{
+    double seconds = timer.seconds();
+    OutStream::console().print("%-16s %-8s %2d threads %8.2f ns/cell %9.1f Mcells/s\n",
+                               name.cstr(), grid.cstr(), threads,
+                               seconds * 1e9 / cells, cells / seconds / 1e6);
+}
+
+bool sameWalls(const CompactMazeGrid& a, const CompactMazeGrid& b)
+{
+    for (int i = 0; i < a.size(); ++i)
+        if (a.open(i, North) != b.open(i, North) || a.open(i, East) != b.open(i, East))
+            return false;
+    return true;
+}
+
+// The parallel generator on 1, 2, 4, ... threads, each maze checked against
+// the 1-thread one.
+template <typename Parallel>
+bool scaling(CString name, int rows, int columns, Parallel parallel)
+{
+    const uint32_t seed = 123456789U;
+    bool passed = true;
+
+    CompactMazeGrid reference(rows, columns);
+    ThreadPool single(1);
+    parallel(reference, seed, single);
+
+    int hardware = std::max(1U, std::thread::hardware_concurrency());
+    for (int threads = 1; ; threads = std::min(2*threads, hardware)) {
+        ThreadPool pool(threads);
+        CompactMazeGrid maze(rows, columns);
+        Stopwatch timer;
+        parallel(maze, seed, pool);
+        report(name, "parallel", threads, timer, maze.size());
+
+        if (!sameWalls(maze, reference)) {
+            OutStream::error().print("%s: maze depends on the thread count\n", name.cstr());
+            passed = false;
+        }
+        if (threads == hardware) break;
+    }
+    return passed;
+}
+
+template <typename Sequential, typename Parallel>
+bool benchmark(CString name, Sequential sequential, Parallel parallel)
+{
+    const uint32_t seed = 123456789U;
+
+    {
+        MazeGrid maze(Rows / 4, Columns / 4);
+        Stopwatch timer;
+        sequential(maze, seed);
+        report(name, "cells", 1, timer, maze.size());
+    }
+
+    {
+        CompactMazeGrid maze(Rows, Columns);
+        Stopwatch timer;
+        sequential(maze, seed);
+        report(name, "compact", 1, timer, maze.size());
+    }
+
+    return scaling(name, Rows, Columns, parallel);
+}
+
+// Eller's streams rows without a grid: into a sink that only checksums
+// them, and into a file.
+void benchmarkEller()
+{
+    const uint32_t seed = 123456789U;
+    const int64_t cells = (int64_t)Rows * Columns;
+
+    {
+        uint64_t checksum = 0;
+        Stopwatch timer;
+        EllerMaze(Rows, Columns, seed, [&](Span<const uint64_t> north, Span<const uint64_t> east) {
+            checksum += north.data[0] ^ east.data[0];
+        });
+        report("Eller", "stream", 1, timer, cells);
+    }
+
+    {
+        FILE* file = tmpfile();
+        Stopwatch timer;
+        EllerMaze(Rows, Columns, seed, MazeRowWriter(file));
+        fflush(file);
+        report("Eller", "file", 1, timer, cells);
+        fclose(file);
+    }
+}
+
+// Kruskal at 10^6 cells and up, in tenfold steps to maxcells.
+bool benchmarkKruskal(int max_cells)
+{
+    const uint32_t seed = 123456789U;
+    bool passed = true;
+
+    for (int cells = 1000000; cells <= max_cells; cells *= 10) {
+        int side = std::lround(std::sqrt(cells));
+        char name[16];
+        snprintf(name, sizeof name, "Kruskal%dM", cells / 1000000);
+
+        {
+            CompactMazeGrid maze(side, side);
+            Stopwatch timer;
+            KruskalMaze(maze, seed);
+            report(name, "compact", 1, timer, maze.size());
+        }
+
+        passed &= scaling(name, side, side,
+                          [](auto& maze, uint32_t seed, ThreadPool& pool) { ParallelKruskalMaze(maze, seed, pool); });
+    }
+    return passed;
+}
+
+// A sequential generator at 10^6 cells and up, in tenfold steps to maxcells.
+template <typename Sequential>
+void benchmarkSizes(const char* name, int max_cells, Sequential sequential)
+{
+    const uint32_t seed = 123456789U;
+
+    for (int cells = 1000000; cells <= max_cells; cells *= 10) {
+        int side = std::lround(std::sqrt(cells));
+        char label[24];
+        snprintf(label, sizeof label, "%s%dM", name, cells / 1000000);
+
+        CompactMazeGrid maze(side, side);
+        Stopwatch timer;
+        sequential(maze, seed);
+        report(label, "compact", 1, timer, maze.size());
+    }
+}
+
+// Solving a 10^7-cell backtracker maze, whose long corridors keep the
+// frontier small, so every step waits on memory: the longest path, then
+// corner to corner by a full search and by the bidirectional one.
+void benchmarkSolver()
+{
+    const int side = 3162;
+    CompactMazeGrid maze(side, side);
+    RecursiveBacktrackerMaze(maze, 123456789U);
+    MazeSolver solver(maze);
+    int corner = maze.size() - 1;
+
+    {
+        Stopwatch timer;
+        Span<const int> longest = solver.longestPath();
+        report("LongestPath", "compact", 1, timer, maze.size());
+        OutStream::console().print("%-16s %d cells, %.3f s\n", "", longest.size, timer.seconds());
+    }
+
+    {
+        Stopwatch timer;
+        solver.fill(0);
+        Span<const int> path = solver.path(corner);
+        report("BFS", "compact", 1, timer, maze.size());
+        OutStream::console().print("%-16s %d cells, %.3f s\n", "", path.size, timer.seconds());
+    }
+
+    {
+        Stopwatch timer;
+        Span<const int> path = solver.solve(0, corner);
+        report("Bidirectional", "compact", 1, timer, maze.size());
+        OutStream::console().print("%-16s %d cells, %.3f s\n", "", path.size, timer.seconds());
+    }
+}
+
+// Path queries for agents: a 1024x1024 Kruskal maze with one wall in ten
+// knocked through for loops, cells costing 1 to 16, and targets within 32
+// rows and columns of the source.
+void benchmarkPathFinding()
+{
+    const int side = 1024, Queries = 2000, Reach = 32;
+    CompactMazeGrid maze(side, side);
+    KruskalMaze(maze, 123456789U);
+    Pcg32 prng(42);
+    Array<uint32_t> cost(maze.size());
+    for (int i = 0; i < maze.size(); ++i) {
+        if (prng() % 10 == 0) maze.link(i, East);
+        if (prng() % 10 == 0) maze.link(i, South);
+        cost[i] = 1 + prng() % 16;
+    }
+
+    Array<int> sources(Queries), targets(Queries);
+    for (int q = 0; q < Queries; ++q) {
+        int row = prng() % side, column = prng() % side;
+        int to_row = std::min(std::max(row + (int)(prng() % (2*Reach+1)) - Reach, 0), side - 1);
+        int to_column = std::min(std::max(column + (int)(prng() % (2*Reach+1)) - Reach, 0), side - 1);
+        sources[q] = row * side + column;
+        targets[q] = to_row * side + to_column;
+    }
+
+    MazeSolver solver(maze);
+    solver.weigh({ cost.size(), &cost[0] });
+    auto queries = [&](const char* name, auto query) {
+        int64_t cells = 0;
+        Stopwatch timer;
+        for (int q = 0; q < Queries; ++q) cells += query(sources[q], targets[q]).size;
+        OutStream::console().print("%-16s %8.2f us/query, paths of %.0f cells\n",
+                                   name, timer.seconds() * 1e6 / Queries, cells / double(Queries));
+    };
+    queries("Bidirectional", [&](int source, int target) { return solver.solve(source, target); });
+    queries("Dijkstra", [&](int source, int target) { return solver.dijkstra(source, target); });
+    queries("A*", [&](int source, int target) { return solver.astar(source, target); });
+}
+
+// maxcells=100000000 adds the 10^8-cell runs; Kruskal's needs about 2.5 GB.
+struct BenchOptions : public Options {
+    kwr_Attrib(maxcells, int, 10000000);
+
+    void set(const Argument& arg)
+    {
+        if (arg.name == maxcells.name) maxcells.set(arg.value);
+    }
+};
+
+int main(int argc, char* args[])
+{
+    BenchOptions config;
+    config.getargs(argc, args);
+    bool passed = true;
+
+    passed &= benchmark("BinaryTree",
+                        [](auto& maze, uint32_t seed) { BinaryTreeMaze(maze, seed); },
+                        [](auto& maze, uint32_t seed, ThreadPool& pool) { ParallelBinaryTreeMaze(maze, seed, pool); });
+    passed &= benchmark("Sidewinder",
+                        [](auto& maze, uint32_t seed) { SidewinderMaze(maze, seed); },
+                        [](auto& maze, uint32_t seed, ThreadPool& pool) { ParallelSidewinderMaze(maze, seed, pool); });
+    benchmarkEller();
+    passed &= benchmarkKruskal(config.maxcells);
+    // The recursive backtracker needs a 100 MB stack at 10^8 cells, not a
+    // call stack.  Aldous-Broder takes minutes there.
+    benchmarkSizes("Backtracker", config.maxcells,
+                   [](auto& maze, uint32_t seed) { RecursiveBacktrackerMaze(maze, seed); });
+    benchmarkSizes("AldousBroder", config.maxcells,
+                   [](auto& maze, uint32_t seed) { AldousBroderMaze(maze, seed); });
+    benchmarkSizes("Wilson", config.maxcells,
+                   [](auto& maze, uint32_t seed) { WilsonMaze(maze, seed); });
+    benchmarkSolver();
+    benchmarkPathFinding();
+
+    OutStream::console().print("%s\n", passed? "All mazes matched.": "Mazes DIFFERED.");
+    return passed? 0: 1;
+}
@@ -1,68 +1,502 @@
-#include "kwrlib.h"
-#include "kwrrnd.h"
-#include "kwrgame.h"
-#include <utility>
-#include <iostream>
-#include <random>
-#include <ctime>
-#include <chrono>
-#include <functional>
-
-using namespace kwr;
-using namespace std;
-
-static const SDL_Color BlackOpaque = { 0,0,0,SDL_ALPHA_OPAQUE};
-
-class TestWindow : public GameDriver
-{
-   public:
-      TestWindow();
-      virtual void Render();
-      virtual void Clear() {}
-
-      bool drawn = false;
-};
-
-TestWindow::TestWindow() : GameDriver(800, 800, BlackOpaque) { }
-
-uint64_t NanoTimer(int loops, function<void (void)> func)
-{
-   auto begin = std::chrono::high_resolution_clock::now();
-   for(int i=0; i<loops; i++) func();
-   auto finish = std::chrono::high_resolution_clock::now();
-   std::chrono::nanoseconds elapsed ( finish - begin );
-   return elapsed.count();
-}
-
-void TestWindow::Render() 
-{
-   if(!drawn)
-   {
-      uint32_t seed = 123456789U;
-      MINSTD minstd(seed);
-      MarsagliaLCG mlcg(seed);
-      XorShift<13,7,17> xorshift(seed);
-      ComplimentaryMultiplyWithCarry cmwc(seed);
-
-      SDL_Color white { 255, 255, 255, SDL_ALPHA_OPAQUE };
-      renderer.SetColor(white); 
-
-      clock_t start, end;
-      int loops = 20000;
-
-      cout << "MINSTD:   " << NanoTimer(loops, [this,&minstd]{ SDL_RenderDrawPoint(renderer, minstd() % 400, minstd() % 400); } ) / 1000 << endl;
-      cout << "MLCG:     " << NanoTimer(loops, [this,&mlcg]{ SDL_RenderDrawPoint(renderer, 400+mlcg() % 400, mlcg() % 400); } ) / 1000 << endl;
-      cout << "XorShift: " << NanoTimer(loops, [this,&xorshift]{ SDL_RenderDrawPoint(renderer, xorshift() % 400, 400+xorshift() % 400); } ) / 1000 << endl;
-      cout << "CMWC:     " << NanoTimer(loops, [this,&cmwc]{ SDL_RenderDrawPoint(renderer, 400+cmwc() % 400, 400+cmwc() % 400); } ) / 1000 << endl;
-      
-      drawn = true;
-   }
-}
-
-int main( int argc, char* args[] )
-{
-   TestWindow testwin;
-   testwin.Run();
-   return 0;
-}
-
+#include "kwrlib.h"
+#include "kwrprng.h"
+#include <chrono>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+using namespace kwr;
+
+// Headless PRNG benchmark and quality suite.
+//
+// Speed: every generator is timed per-call through the RandomSequence
+// interface, with direct operator() calls, and through the non-virtual bulk
+// fill() path, reported as ns/value, cycles/value and GB/s.
+//
+// Quality: cheap statistical smoke tests on each stream, a chi-square over
+// 256 buckets, lag-1 serial correlation and per-bit bias.  They catch broken
+// generators, not subtle ones.
+
+static const int Values = 1 << 25;
+static const int BufferSize = 4096;
+static const int Samples = 1 << 20;
+
+static uint64_t cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+class Stopwatch {
+  public:
+    double seconds() const
+    {
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        return elapsed.count();
+    }
+
+    uint64_t ticks() const { return cycles() - start_cycles; }
+
+  private:
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    uint64_t start_cycles = cycles();
+};
+
+// Hide the dynamic type so the compiler cannot devirtualise the calls.
+RandomSequence& opaque(RandomSequence& sequence)
+{
+    RandomSequence* volatile pointer = &sequence;
+    return *pointer;
+}
+
+void report(CString name, CString path, const Stopwatch& timer, uint32_t checksum, int bytes = sizeof(uint32_t))
+{
+    double seconds = timer.seconds();
+    OutStream::console().print("%-12s %-8s %8.2f ns %8.2f cyc %8.1f M/s %7.2f GB/s  (checksum %08x)\n",
+                               name.cstr(), path.cstr(),
+                               seconds * 1e9 / Values, (double)timer.ticks() / Values,
+                               Values / seconds / 1e6, (double)Values * bytes / seconds / 1e9,
+                               checksum);
+}
+
+void verdict(CString name, CString test, double value, bool passed)
+{
+    OutStream::console().print("%-12s %-8s %10.4f  %s\n", name.cstr(), test.cstr(), value, passed? "ok": "FAIL");
+}
+
+// Chi-square of the top byte of each value over 256 buckets: 255 degrees of
+// freedom, so the statistic should land within about 2.6 sigma of 255.
+bool chiSquare(CString name, const uint32_t* values, int n, int bits)
+{
+    int buckets[256] {};
+    for (int k = 0; k < n; ++k)
+        ++buckets[(values[k] >> (bits - 8)) & 0xFF];
+
+    double expected = n / 256.0, chi2 = 0;
+    for (int count : buckets)
+        chi2 += (count - expected) * (count - expected) / expected;
+
+    bool passed = std::fabs(chi2 - 255) < 2.6 * std::sqrt(2 * 255.0);
+    verdict(name, "chi2", chi2, passed);
+    return passed;
+}
+
+// Lag-1 serial correlation; for independent values it is about N(0, 1/n).
+bool serialCorrelation(CString name, const uint32_t* values, int n)
+{
+    double sum = 0, sum2 = 0, cross = 0;
+    for (int k = 0; k < n; ++k) {
+        double x = values[k], y = values[(k + 1) % n];
+        sum += x;
+        sum2 += x * x;
+        cross += x * y;
+    }
+
+    double r = (n * cross - sum * sum) / (n * sum2 - sum * sum);
+    bool passed = std::fabs(r) < 4 / std::sqrt((double)n);
+    verdict(name, "serial", r, passed);
+    return passed;
+}
+
+// Largest z-score of the count of ones in any one bit position.
+bool bitBias(CString name, const uint32_t* values, int n, int bits)
+{
+    double worst = 0;
+    for (int bit = 0; bit < bits; ++bit) {
+        int ones = 0;
+        for (int k = 0; k < n; ++k)
+            ones += (values[k] >> bit) & 1;
+        worst = std::max(worst, std::fabs(ones - n / 2.0) / std::sqrt(n / 4.0));
+    }
+
+    bool passed = worst < 4.5;
+    verdict(name, "bitbias", worst, passed);
+    return passed;
+}
+
+// bits: output width, 31 for the Park-Miller style LCGs.  The direct and
+// fill paths run at the generator's native width; virtual calls and the
+// quality checks see the 32-bit words that get() and draw32() give.
+template <typename PRNG>
+bool benchmark(CString name, uint32_t seed, int bits = 32)
+{
+    typedef typename PRNG::Type Type;
+    uint32_t virtual_sum = 0, high_sum = 0;
+    Type direct_sum = 0, fill_sum = 0;
+
+    {
+        PRNG prng(seed);
+        RandomSequence& sequence = opaque(prng);
+        Stopwatch timer;
+        for (int n = 0; n < Values; ++n) {
+            sequence.next();
+            virtual_sum += sequence.get();
+        }
+        report(name, "virtual", timer, virtual_sum);
+    }
+
+    {
+        PRNG prng(seed);
+        Stopwatch timer;
+        for (int n = 0; n < Values; ++n)
+            direct_sum += prng();
+        report(name, "direct", timer, direct_sum, sizeof(Type));
+    }
+
+    {
+        PRNG prng(seed);
+        Array<Type> buffer(BufferSize);
+        Span<Type> values { buffer.size(), &buffer[0] };
+        Stopwatch timer;
+        for (int n = 0; n < Values; n += BufferSize) {
+            prng.fill(values);
+            for (int k = 0; k < BufferSize; ++k) {
+                fill_sum += values.data[k];
+                high_sum += values.data[k] >> (8*sizeof(Type) - 32);
+            }
+        }
+        report(name, "fill", timer, fill_sum, sizeof(Type));
+    }
+
+    bool passed = true;
+    if (virtual_sum != high_sum || direct_sum != fill_sum) {
+        OutStream::error().print("%s: fill() and per-call streams differ\n", name.cstr());
+        passed = false;
+    }
+
+    PRNG prng(seed);
+    Array<uint32_t> sample(Samples);
+    Span<uint32_t> words { Samples, &sample[0] };
+    prng.fill(words);
+    passed &= chiSquare(name, &sample[0], Samples, bits);
+    passed &= serialCorrelation(name, &sample[0], Samples);
+    passed &= bitBias(name, &sample[0], Samples, bits);
+    return passed;
+}
+
+// Reseed then take the first draws, over and over, as when each task or
+// maze gets a generator of its own: the seeding cost is amortised over only
+// draws values, so small lags win for short streams.
+template <typename PRNG>
+void benchmarkReseed(CString name, CString path, uint32_t seed, int draws)
+{
+    PRNG prng(seed);
+    uint32_t buffer[BufferSize];
+    uint32_t sum = 0;
+    Stopwatch timer;
+    for (int n = 0; n < Values; n += draws) {
+        prng.seed(seed + n);
+        prng.fill(buffer, draws);
+        sum += buffer[draws - 1];
+    }
+    report(name, path, timer, sum);
+}
+
+template <typename PRNG>
+void benchmarkReseed(CString name, uint32_t seed)
+{
+    benchmarkReseed<PRNG>(name, "seed+16", seed, 16);
+    benchmarkReseed<PRNG>(name, "seed+256", seed, 256);
+    benchmarkReseed<PRNG>(name, "seed+4k", seed, 4096);
+}
+
+// Counter-based generators can also be sampled as a pure function of the index.
+void benchmarkRandomAccess(CString name, uint64_t key)
+{
+    uint32_t sum = 0;
+    Stopwatch timer;
+    for (int n = 0; n < Values; ++n)
+        sum += Philox::random(key, n);
+    report(name, "random", timer, sum);
+}
+
+// The modulo-rejection method RandomUniform used before RandomBounded: a
+// divide for the threshold and another for the remainder on every draw.
+uint32_t moduloBounded(XorShift0& prng, uint32_t range)
+{
+    uint32_t threshold = -range % range;
+    uint32_t r;
+    while ((r = prng()) < threshold) {}
+    return r % range;
+}
+
+// Bounded draws with a varying range, as SidewinderMaze does per run, then
+// a fixed range through the per-value and batch paths.
+void benchmarkBounded(uint32_t seed)
+{
+    {
+        XorShift0 prng(seed);
+        uint32_t sum = 0;
+        Stopwatch timer;
+        for (int n = 0; n < Values; ++n)
+            sum += moduloBounded(prng, 1 + (n & 15));
+        report("Bounded", "modulo", timer, sum);
+    }
+
+    {
+        XorShift0 prng(seed);
+        uint32_t sum = 0;
+        Stopwatch timer;
+        for (int n = 0; n < Values; ++n)
+            sum += RandomBounded::bounded(prng, 1 + (n & 15));
+        report("Bounded", "lemire", timer, sum);
+    }
+
+    {
+        XorShift0 prng(seed);
+        uint32_t sum = 0;
+        Stopwatch timer;
+        for (int n = 0; n < Values; ++n)
+            sum += moduloBounded(prng, 1000);
+        report("Bounded1000", "modulo", timer, sum);
+    }
+
+    {
+        XorShift0 prng(seed);
+        RandomBounded bounded(1000);
+        uint32_t sum = 0;
+        Stopwatch timer;
+        for (int n = 0; n < Values; ++n)
+            sum += bounded(prng);
+        report("Bounded1000", "lemire", timer, sum);
+    }
+
+    {
+        XorShift0 prng(seed);
+        RandomBounded bounded(1000);
+        Array<uint32_t> buffer(BufferSize);
+        uint32_t sum = 0;
+        Stopwatch timer;
+        for (int n = 0; n < Values; n += BufferSize) {
+            bounded.fill(prng, &buffer[0], BufferSize);
+            for (int k = 0; k < BufferSize; ++k)
+                sum += buffer[k];
+        }
+        report("Bounded1000", "batch", timer, sum);
+    }
+}
+
+// Uniform doubles: the old divide by prng.max(), bit construction per
+// value, and batch conversion of a generator's fill() output.
+void benchmarkDoubles(uint32_t seed)
+{
+    typedef XorShiftN<13,17,5,8> Source;
+
+    {
+        Source prng(seed);
+        double sum = 0;
+        Stopwatch timer;
+        for (int n = 0; n < Values; ++n)
+            sum += (double)prng() / (double)0xFFFFFFFFU;
+        report("Double", "divide", timer, (uint32_t)sum, sizeof(double));
+    }
+
+    {
+        Source prng(seed);
+        RandomDouble uniform;
+        double sum = 0;
+        Stopwatch timer;
+        for (int n = 0; n < Values; ++n)
+            sum += uniform(prng);
+        report("Double", "bits", timer, (uint32_t)sum, sizeof(double));
+    }
+
+    {
+        Source prng(seed);
+        RandomDouble uniform;
+        Array<double> buffer(BufferSize);
+        double sum = 0;
+        Stopwatch timer;
+        for (int n = 0; n < Values; n += BufferSize) {
+            uniform.fill(prng, &buffer[0], BufferSize);
+            for (int k = 0; k < BufferSize; ++k)
+                sum += buffer[k];
+        }
+        report("Double", "batch", timer, (uint32_t)sum, sizeof(double));
+    }
+}
+
+// Standard normals: Box-Muller with log, sqrt and cos per pair against the
+// ziggurat, per value and in batch.
+void benchmarkNormal(uint32_t seed)
+{
+    typedef XorShiftN<13,17,5,8> Source;
+
+    {
+        Source prng(seed);
+        double sum = 0;
+        Stopwatch timer;
+        for (int n = 0; n < Values; n += 2) {
+            double radius = std::sqrt(-2 * std::log((prng() + 0.5) * 0x1.0p-32));
+            double angle = 2 * M_PI * RandomDouble()(prng);
+            sum += radius * std::cos(angle) + radius * std::sin(angle);
+        }
+        report("Normal", "b-muller", timer, (uint32_t)sum, sizeof(double));
+    }
+
+    {
+        Source prng(seed);
+        RandomNormal normal;
+        double sum = 0;
+        Stopwatch timer;
+        for (int n = 0; n < Values; ++n)
+            sum += normal(prng);
+        report("Normal", "ziggurat", timer, (uint32_t)sum, sizeof(double));
+    }
+
+    {
+        Source prng(seed);
+        RandomNormal normal;
+        Array<double> buffer(BufferSize);
+        double sum = 0;
+        Stopwatch timer;
+        for (int n = 0; n < Values; n += BufferSize) {
+            normal.fill(prng, &buffer[0], BufferSize);
+            for (int k = 0; k < BufferSize; ++k)
+                sum += buffer[k];
+        }
+        report("Normal", "batch", timer, (uint32_t)sum, sizeof(double));
+    }
+}
+
+// Weighted choice among 16 outcomes: linear scan of the cumulative weights
+// against the alias table, per value and in batch.
+void benchmarkWeighted(uint32_t seed)
+{
+    const int n = 16;
+    double weights[n], cumulative[n], total = 0;
+    for (int k = 0; k < n; ++k) {
+        weights[k] = 1 + k % 5;
+        cumulative[k] = total += weights[k];
+    }
+
+    {
+        XorShift0 prng(seed);
+        RandomDouble uniform;
+        uint32_t sum = 0;
+        Stopwatch timer;
+        for (int v = 0; v < Values; ++v) {
+            double target = uniform(prng) * total;
+            int k = 0;
+            while (k < n-1 && cumulative[k] <= target) ++k;
+            sum += k;
+        }
+        report("Weighted", "scan", timer, sum);
+    }
+
+    {
+        XorShift0 prng(seed);
+        AliasSampler sampler(weights, n);
+        uint32_t sum = 0;
+        Stopwatch timer;
+        for (int v = 0; v < Values; ++v)
+            sum += sampler(prng);
+        report("Weighted", "alias", timer, sum);
+    }
+
+    {
+        XorShift0 prng(seed);
+        AliasSampler sampler(weights, n);
+        Array<uint32_t> buffer(BufferSize);
+        uint32_t sum = 0;
+        Stopwatch timer;
+        for (int v = 0; v < Values; v += BufferSize) {
+            sampler.fill(prng, &buffer[0], BufferSize);
+            for (int k = 0; k < BufferSize; ++k)
+                sum += buffer[k];
+        }
+        report("Weighted", "batch", timer, sum);
+    }
+}
+
+// Shuffling Values elements: sequential Fisher-Yates against MergeShuffle
+// on every hardware thread.
+void benchmarkShuffle(uint32_t seed)
+{
+    Array<uint32_t> data(Values);
+    for (int i = 0; i < Values; ++i) data[i] = i;
+
+    {
+        FisherYatesShuffler<XorShift0> shuffler { XorShift0(seed) };
+        Stopwatch timer;
+        shuffler.shuffle(&data[0], Values);
+        report("Shuffle", "fisher", timer, data[0]);
+    }
+
+    {
+        ThreadPool pool;
+        MergeShuffler shuffler(seed, pool);
+        Stopwatch timer;
+        shuffler(data);
+        report("Shuffle", "merge", timer, data[0]);
+    }
+}
+
+// Picking a few cells from a 10^8-cell grid: Floyd's k-of-n repeatedly, then
+// one reservoir pass over Values items.  Both cost O(k) memory.
+void benchmarkSubset(uint32_t seed)
+{
+    const int k = 64;
+    uint32_t picked[k];
+    XorShift0 prng(seed);
+
+    {
+        RandomSubset subset(k);
+        uint32_t sum = 0;
+        Stopwatch timer;
+        for (int n = 0; n < Values; n += k) {
+            subset(prng, 100000000, picked, k);
+            sum += picked[0];
+        }
+        report("Subset", "floyd", timer, sum);
+    }
+
+    {
+        ReservoirSampler<uint32_t> sampler(Span<uint32_t>{ k, picked });
+        CountingSequence items(Values);
+        Stopwatch timer;
+        sampler(prng, items);
+        report("Subset", "stream", timer, picked[0]);
+    }
+}
+
+int main()
+{
+    uint32_t seed = 123456789U;
+    bool passed = true;
+
+    passed &= benchmark<XorShift0>("XorShift", seed);
+    passed &= benchmark<XorShiftN<13,17,5,4>>("XorShiftx4", seed);
+    passed &= benchmark<XorShiftN<13,17,5,8>>("XorShiftx8", seed);
+    passed &= benchmark<XorShiftN<13,17,5,16>>("XorShiftx16", seed);
+    passed &= benchmark<MINSTD>("MINSTD", seed, 31);
+    passed &= benchmark<MarsagliaLCG>("MLCG", seed, 31);
+    passed &= benchmark<ComplimentaryMultiplyWithCarry>("CMWC", seed);
+    passed &= benchmark<CMWC256>("CMWC256", seed);
+    passed &= benchmark<CMWC32>("CMWC32", seed);
+    passed &= benchmark<CMWC8>("CMWC8", seed);
+    passed &= benchmark<Philox>("Philox", seed);
+    passed &= benchmark<Xoshiro256>("Xoshiro256", seed);
+    passed &= benchmark<Xoroshiro128Plus>("Xoroshiro+", seed);
+    passed &= benchmark<Pcg32>("PCG32", seed);
+    benchmarkRandomAccess("Philox", seed);
+    benchmarkReseed<ComplimentaryMultiplyWithCarry>("CMWC", seed);
+    benchmarkReseed<CMWC256>("CMWC256", seed);
+    benchmarkReseed<CMWC32>("CMWC32", seed);
+    benchmarkReseed<CMWC8>("CMWC8", seed);
+    benchmarkBounded(seed);
+    benchmarkDoubles(seed);
+    benchmarkNormal(seed);
+    benchmarkWeighted(seed);
+    benchmarkShuffle(seed);
+    benchmarkSubset(seed);
+
+    OutStream::console().print("%s\n", passed? "All quality checks passed.": "Quality checks FAILED.");
+    return passed? 0: 1;
+}
@@ -0,0 +1,239 @@
+#include "kwrlib.h"
+#include "kwrmaze.h"
+
+using namespace kwr;
+
+template <typename GridA, typename GridB>
+bool sameWalls(const GridA& a, const GridB& b)
+{
+    if (a.size() != b.size()) return false;
+    for (int i = 0; i < a.size(); ++i)
+        for (int d = 0; d < 4; ++d)
+            if (a.open(i, d) != b.open(i, d) || a.neighbor(i, d) != b.neighbor(i, d))
+                return false;
+    return true;
+}
+
+// A perfect maze: size-1 passages, and every cell reachable from cell 0.
+template <typename Grid>
+bool isPerfect(const Grid& maze)
+{
+    int passages = 0;
+    for (int i = 0; i < maze.size(); ++i)
+        passages += maze.open(i, East) + maze.open(i, South);
+
+    Array<int> stack(maze.size());
+    Array<bool> seen(maze.size());
+    for (int i = 0; i < maze.size(); ++i) seen[i] = false;
+
+    int top = 0, reached = 1;
+    stack[top++] = 0;
+    seen[0] = true;
+    while (top) {
+        int cell = stack[--top];
+        for (int d = 0; d < 4; ++d) {
+            int next = maze.neighbor(cell, d);
+            if (next >= 0 && maze.open(cell, d) && !seen[next]) {
+                seen[next] = true;
+                stack[top++] = next;
+                ++reached;
+            }
+        }
+    }
+    return passages == maze.size() - 1 && reached == maze.size();
+}
+
+kwr_TestCase(CompactGridLayout)
+{
+    CompactMazeGrid maze(3, 70);
+    kwr_test(maze.stride == 2);
+    kwr_test(maze.size() == 210);
+    kwr_test(maze.neighbor(0, North) == -1 && maze.neighbor(0, West) == -1);
+    kwr_test(maze.neighbor(69, East) == -1 && maze.neighbor(69, South) == 139);
+    kwr_test(maze.neighbor(140, South) == -1 && maze.neighbor(140, North) == 70);
+
+    // A passage opened from either side reads the same from both, across
+    // the word boundary between columns 63 and 64 too.
+    maze.link(70 + 63, East);
+    maze.link(140 + 5, North);
+    kwr_test(maze.open(70 + 63, East) && maze.open(70 + 64, West));
+    kwr_test(maze.open(70 + 5, South) && maze.open(140 + 5, North));
+    kwr_test(!maze.open(70 + 64, East) && !maze.open(70 + 63, West));
+
+    // Links through the boundary are ignored, as Cell::link(nullptr) is.
+    maze.link(69, East);
+    maze.link(0, North);
+    kwr_test(!maze.open(69, East) && !maze.open(70, West) && !maze.open(0, North));
+}
+
+kwr_TestCase(CompactGridMatchesCells)
+{
+    MazeGrid cells(17, 90);
+    CompactMazeGrid compact(17, 90);
+    BinaryTreeMaze(cells, 8423032);
+    BinaryTreeMaze(compact, 8423032);
+    kwr_test(sameWalls(cells, compact));
+    kwr_test(isPerfect(compact));
+
+    MazeGrid cells2(17, 90);
+    CompactMazeGrid compact2(17, 90);
+    SidewinderMaze(cells2, 1);
+    SidewinderMaze(compact2, 1);
+    kwr_test(sameWalls(cells2, compact2));
+    kwr_test(isPerfect(compact2));
+}
+
+kwr_TestCase(ParallelMazesIgnoreThreadCount)
+{
+    ThreadPool one(1), four(4);
+
+    CompactMazeGrid tree1(50, 130), tree4(50, 130);
+    MazeGrid tree_cells(50, 130);
+    ParallelBinaryTreeMaze(tree1, 77, one);
+    ParallelBinaryTreeMaze(tree4, 77, four);
+    ParallelBinaryTreeMaze(tree_cells, 77, four);
+    kwr_test(sameWalls(tree1, tree4));
+    kwr_test(sameWalls(tree1, tree_cells));
+    kwr_test(isPerfect(tree4));
+
+    CompactMazeGrid side1(50, 130), side4(50, 130);
+    MazeGrid side_cells(50, 130);
+    ParallelSidewinderMaze(side1, 77, one);
+    ParallelSidewinderMaze(side4, 77, four);
+    ParallelSidewinderMaze(side_cells, 77, four);
+    kwr_test(sameWalls(side1, side4));
+    kwr_test(sameWalls(side1, side_cells));
+    kwr_test(isPerfect(side4));
+}
+
+// Copies Eller's rows into a grid, in order.
+class GridRowSink {
+  public:
+    explicit GridRowSink(CompactMazeGrid& g) : grid(g) {}
+
+    void operator()(Span<const uint64_t> north, Span<const uint64_t> east)
+    {
+        std::memcpy(grid.northRow(row), north.data, sizeof(uint64_t) * north.size);
+        std::memcpy(grid.eastRow(row), east.data, sizeof(uint64_t) * east.size);
+        ++row;
+    }
+
+  private:
+    CompactMazeGrid& grid;
+    int row = 0;
+};
+
+kwr_TestCase(EllerStreaming)
+{
+    for (int columns : { 1, 2, 63, 64, 65, 200 }) {
+        CompactMazeGrid maze(40, columns);
+        EllerMaze(40, columns, 2024, GridRowSink(maze));
+        kwr_test(isPerfect(maze));
+    }
+
+    CompactMazeGrid single(1, 10);
+    EllerMaze(1, 10, 5, GridRowSink(single));
+    kwr_test(isPerfect(single));
+
+    // The file format is the grid's rows, north words then east words.
+    CompactMazeGrid maze(30, 100);
+    EllerMaze(30, 100, 99, GridRowSink(maze));
+    FILE* file = tmpfile();
+    EllerMaze(30, 100, 99, MazeRowWriter(file));
+    rewind(file);
+    bool same = true;
+    for (int r = 0; r < 30; ++r) {
+        uint64_t words[4];
+        kwr_test(fread(words, sizeof(uint64_t), 4, file) == 4);
+        same &= std::memcmp(words, maze.northRow(r), 16) == 0;
+        same &= std::memcmp(words + 2, maze.eastRow(r), 16) == 0;
+    }
+    kwr_test(same);
+    fclose(file);
+}
+
+kwr_TestCase(DisjointSetsUnite)
+{
+    DisjointSets sets(10);
+    kwr_test(sets.unite(1, 2) && sets.unite(3, 4) && sets.unite(2, 4));
+    kwr_test(!sets.unite(1, 3));
+    kwr_test(sets.find(1) == sets.find(4) && sets.root(4) == sets.find(3));
+    kwr_test(sets.find(0) == 0 && sets.find(5) != sets.find(1));
+}
+
+kwr_TestCase(KruskalMazes)
+{
+    MazeGrid cells(23, 41);
+    CompactMazeGrid compact(23, 41);
+    KruskalMaze(cells, 31);
+    KruskalMaze(compact, 31);
+    kwr_test(isPerfect(compact));
+    kwr_test(sameWalls(cells, compact));
+
+    ThreadPool one(1), four(4);
+    CompactMazeGrid parallel1(60, 70), parallel4(60, 70);
+    ParallelKruskalMaze(parallel1, 31, one);
+    ParallelKruskalMaze(parallel4, 31, four);
+    kwr_test(isPerfect(parallel1));
+    kwr_test(sameWalls(parallel1, parallel4));
+
+    CompactMazeGrid column(50, 1), row(1, 50);
+    KruskalMaze(column, 2);
+    ParallelKruskalMaze(row, 2, four);
+    kwr_test(isPerfect(column) && isPerfect(row));
+}
+
+kwr_TestCase(RecursiveBacktracker)
+{
+    MazeGrid cells(37, 29);
+    CompactMazeGrid compact(37, 29);
+    RecursiveBacktrackerMaze(cells, 5);
+    RecursiveBacktrackerMaze(compact, 5);
+    kwr_test(isPerfect(compact));
+    kwr_test(sameWalls(cells, compact));
+
+    CompactMazeGrid single(1, 1), column(40, 1), row(1, 40);
+    RecursiveBacktrackerMaze(single, 9);
+    RecursiveBacktrackerMaze(column, 9);
+    RecursiveBacktrackerMaze(row, 9);
+    kwr_test(isPerfect(single) && isPerfect(column) && isPerfect(row));
+}
+
+// Spanning-tree generators on a 2x3 grid, whose 15 mazes should come up
+// equally often: for each, the share of the commonest maze.
+template <typename Generator>
+double commonestShare(Generator generator)
+{
+    const int Trials = 6000;
+    Array<int> counts(1 << 12);
+    std::fill(&counts[0], &counts[0] + counts.size(), 0);
+    for (int seed = 1; seed <= Trials; ++seed) {
+        CompactMazeGrid maze(2, 3);
+        generator(maze, seed);
+        int walls = 0;
+        for (int i = 0; i < maze.size(); ++i)
+            walls = walls << 2 | maze.open(i, East) << 1 | maze.open(i, South);
+        ++counts[walls];
+    }
+    return *std::max_element(&counts[0], &counts[0] + counts.size()) / double(Trials);
+}
+
+kwr_TestCase(SpanningTreeMazes)
+{
+    MazeGrid cells(31, 17);
+    CompactMazeGrid aldous_broder(31, 17), wilson(31, 17);
+    AldousBroderMaze(cells, 77);
+    AldousBroderMaze(aldous_broder, 77);
+    WilsonMaze(wilson, 77);
+    kwr_test(sameWalls(cells, aldous_broder));
+    kwr_test(isPerfect(aldous_broder) && isPerfect(wilson));
+
+    CompactMazeGrid single(1, 1);
+    AldousBroderMaze(single, 1);
+    WilsonMaze(single, 1);
+    kwr_test(isPerfect(single));
+
+    // 1/15 is 0.067.
+    kwr_test(commonestShare([](CompactMazeGrid& maze, int seed) { AldousBroderMaze(maze, seed); }) < 0.08);
+    kwr_test(commonestShare([](CompactMazeGrid& maze, int seed) { WilsonMaze(maze, seed); }) < 0.08);
+}
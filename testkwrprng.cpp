@@ -0,0 +1,412 @@
+#include "kwrlib.h"
+#include "kwrerr.h"
+#include "kwrprng.h"
+
+using namespace kwr;
+
+template <typename PRNG>
+bool fillMatchesCalls(uint32_t seed)
+{
+    typedef typename PRNG::Type Type;
+    PRNG called(seed), filled(seed);
+    Type values[100];
+    filled.fill(values, 37);
+    filled.fill(Span<Type>{ 63, values+37 });
+
+    for (int i = 0; i < 100; ++i)
+        if (values[i] != called()) return false;
+    return called() == filled();
+}
+
+kwr_TestCase(PrngFill)
+{
+    kwr_test(fillMatchesCalls<XorShift0>(123456789));
+    kwr_test(fillMatchesCalls<MINSTD>(123456789));
+    kwr_test(fillMatchesCalls<MarsagliaLCG>(123456789));
+    kwr_test(fillMatchesCalls<ComplimentaryMultiplyWithCarry>(123456789));
+    kwr_test(fillMatchesCalls<CMWC8>(123456789));
+    kwr_test(fillMatchesCalls<CMWC256>(123456789));
+    kwr_test(fillMatchesCalls<Xoshiro256>(123456789));
+    kwr_test(fillMatchesCalls<Xoroshiro128Plus>(123456789));
+    kwr_test(fillMatchesCalls<Pcg32>(123456789));
+}
+
+template <typename PRNG>
+bool reseedMatchesFresh(uint32_t seed)
+{
+    PRNG fresh(seed), reused(seed + 1);
+    for (int i = 0; i < 1000; ++i) reused();
+    reused.seed(seed);
+
+    for (int i = 0; i < 1000; ++i)
+        if (fresh() != reused()) return false;
+    return true;
+}
+
+kwr_TestCase(CmwcReseed)
+{
+    kwr_test(reseedMatchesFresh<CMWC8>(42));
+    kwr_test(reseedMatchesFresh<CMWC32>(42));
+    kwr_test(reseedMatchesFresh<ComplimentaryMultiplyWithCarry>(42));
+    kwr_test(sizeof(CMWC8) < 64);
+}
+
+template <int Lanes>
+bool lanesAreXorShifts(uint32_t seed)
+{
+    XorShiftN<13,17,5,Lanes> lanes(seed);
+    uint32_t values[10*Lanes];
+    lanes.fill(values, 10*Lanes);
+
+    for (int l = 0; l < Lanes; ++l) {
+        XorShift0 scalar(values[l]);
+        for (int k = 1; k < 10; ++k)
+            if (values[k*Lanes + l] != scalar()) return false;
+    }
+    return true;
+}
+
+kwr_TestCase(XorShiftLanes)
+{
+    kwr_test(lanesAreXorShifts<3>(42));
+    kwr_test(lanesAreXorShifts<4>(42));
+    kwr_test(lanesAreXorShifts<8>(42));
+    kwr_test(lanesAreXorShifts<16>(42));
+
+    typedef XorShiftN<13,17,5,8> XorShift0x8;
+    kwr_test(fillMatchesCalls<XorShift0x8>(123456789));
+}
+
+template <typename PRNG>
+bool advanceMatchesSteps(uint32_t seed, uint64_t n)
+{
+    PRNG stepped(seed), jumped(seed);
+    for (uint64_t i = 0; i < n; ++i) stepped.next();
+    jumped.advance(n);
+    return stepped() == jumped();
+}
+
+kwr_TestCase(PrngAdvance)
+{
+    for (uint64_t n : { 0, 1, 2, 3, 1000, 65537 }) {
+        kwr_test(advanceMatchesSteps<XorShift0>(123456789, n));
+        kwr_test(advanceMatchesSteps<MINSTD>(123456789, n));
+        kwr_test(advanceMatchesSteps<MarsagliaLCG>(123456789, n));
+        kwr_test(advanceMatchesSteps<Pcg32>(123456789, n));
+    }
+
+    // Worker k of a split job starts exactly where the sequence reaches k*N.
+    const uint64_t N = 1000000000000ULL;
+    MINSTD whole(7), part(7);
+    whole.advance(3*N);
+    for (int k = 0; k < 3; ++k) part.advance(N);
+    kwr_test(whole() == part());
+}
+
+kwr_TestCase(SixtyFourBitKnownAnswers)
+{
+    // xoshiro256** from state {1, 2, 3, 4}, xoroshiro128+ from {1, 2}.
+    uint64_t s4[4] = { 1, 2, 3, 4 };
+    kwr_test(Xoshiro256::step(s4) == 11520);
+    kwr_test(Xoshiro256::step(s4) == 0);
+    kwr_test(Xoshiro256::step(s4) == 1509978240);
+    uint64_t s2[2] = { 1, 2 };
+    kwr_test(Xoroshiro128Plus::step(s2) == 3);
+    kwr_test(Xoroshiro128Plus::step(s2) == 0x6001030003ULL);
+
+    // SplitMix64 seeding, then the jump polynomials.
+    Xoshiro256 xoshiro(7);
+    Xoshiro256 jumped(7);
+    jumped.jump();
+    kwr_test(xoshiro() == 0xB358FAF74EF9765AULL);
+    kwr_test(jumped() == 0x156617FD83DF2A74ULL);
+    Xoroshiro128Plus xoroshiro(7);
+    xoroshiro.jump();
+    kwr_test(xoroshiro() == 0xD3763F4C115750C1ULL);
+
+    // The 32-bit words are the high halves, for get() and the adapters.
+    Xoshiro256 wide(9), narrow(9);
+    uint32_t words[3];
+    narrow.fill(words, 3);
+    kwr_test(words[0] == wide() >> 32 && words[1] == draw32(wide));
+    wide.next();
+    kwr_test(words[2] == wide.get());
+
+    // pcg32-global-demo: seed 42, stream 54.
+    Pcg32 pcg(42, 54);
+    kwr_test(pcg() == 0xa15c02b7);
+    kwr_test(pcg() == 0x7b47f409);
+    kwr_test(pcg() == 0xba1d3330);
+}
+
+kwr_TestCase(PhiloxKnownAnswers)
+{
+    // Random123 known-answer vectors for philox4x32-10.
+    Philox::Block zero = Philox::generate(0, 0, 0);
+    kwr_test(zero.word[0] == 0x6627e8d5 && zero.word[1] == 0xe169c58d);
+    kwr_test(zero.word[2] == 0xbc57ac4c && zero.word[3] == 0x9b00dbd8);
+
+    Philox::Block ones = Philox::generate(~0ULL, ~0ULL, ~0ULL);
+    kwr_test(ones.word[0] == 0x408f276d && ones.word[1] == 0x41c83b0e);
+    kwr_test(ones.word[2] == 0xa20bc7c6 && ones.word[3] == 0x6d5451fd);
+
+    Philox::Block pi = Philox::generate(0x299f31d0a4093822ULL, 0x0370734413198a2eULL, 0x85a308d3243f6a88ULL);
+    kwr_test(pi.word[0] == 0xd16cfe09 && pi.word[1] == 0x94fdcceb);
+    kwr_test(pi.word[2] == 0x5001e420 && pi.word[3] == 0x24126ea1);
+}
+
+kwr_TestCase(PhiloxRandomAccess)
+{
+    kwr_test(fillMatchesCalls<Philox>(123456789));
+
+    Philox sequential(99);
+    for (uint64_t i = 0; i < 10; ++i)
+        kwr_test(sequential() == Philox::random(99, i));
+
+    Philox skipped(99);
+    skipped.advance(1001);
+    kwr_test(skipped() == Philox::random(99, 1001));
+}
+
+kwr_TestCase(BoundedRange)
+{
+    XorShift0 prng(2024);
+    int counts[7] {};
+    for (int n = 0; n < 7000; ++n) {
+        uint32_t r = RandomBounded::bounded(prng, 7);
+        kwr_test(r < 7);
+        ++counts[r];
+    }
+    for (int count : counts)
+        kwr_test(count > 800 && count < 1200);
+
+    uint32_t batch[1000];
+    RandomBounded(3).fill(prng, batch, 1000);
+    for (uint32_t r : batch)
+        kwr_test(r < 3);
+
+    // Range close to 2^32 exercises the rejection path.
+    RandomBounded wide(0xC0000000U);
+    for (int n = 0; n < 1000; ++n)
+        kwr_test(wide(prng) < 0xC0000000U);
+}
+
+kwr_TestCase(RandomUnitInterval)
+{
+    kwr_test(RandomDouble::convert(0) == 0.0);
+    kwr_test(RandomDouble::convert(0xFFFFFFFF) == 1.0 - 0x1.0p-32);
+    kwr_test(RandomDouble::convert(0x80000000) == 0.5);
+    kwr_test(RandomFloat::convert(0xFFFFFFFF) == 1.0f - 0x1.0p-23f);
+    kwr_test(RandomDouble53::convert(0xFFFFFFFF, 0xFFFFFFFF) == 1.0 - 0x1.0p-53);
+    kwr_test(RandomDouble53::convert(0, 0x800) == 0x1.0p-53);
+
+    XorShift0 called(5), filled(5);
+    double values[300];
+    RandomDouble().fill(filled, values, 300);
+    for (double value : values)
+        kwr_test(value == RandomDouble()(called));
+
+    XorShift0 pairs(5), pairs_filled(5);
+    RandomDouble53().fill(pairs_filled, values, 300);
+    for (double value : values)
+        kwr_test(value >= 0.0 && value < 1.0 && value == RandomDouble53()(pairs));
+}
+
+static_assert(XorShiftEngine<1,3,10>(1)() == 3075, "constexpr XorShift");
+static_assert(MinstdEngine(1)() == 48271, "constexpr MINSTD");
+
+kwr_TestCase(ConstexprTables)
+{
+    static constexpr auto perm = permutationTable<256>(MinstdEngine(90837492));
+
+    bool seen[256] {};
+    for (uint32_t p : perm) seen[p] = true;
+    for (bool s : seen) kwr_test(s);
+
+    // Same shuffle as the runtime generator class.
+    uint32_t runtime[256];
+    for (int i = 0; i < 256; ++i) runtime[i] = i;
+    FisherYatesShuffler<MINSTD> shuffler(MINSTD(90837492));
+    shuffler.shuffle(runtime, 256);
+    for (int i = 0; i < 256; ++i) kwr_test(runtime[i] == perm[i]);
+
+    static constexpr auto values = uniformTable<16>(XorShift0Engine(7));
+    XorShift0 xorshift(7);
+    for (double value : values) kwr_test(value == RandomDouble()(xorshift));
+}
+
+kwr_TestCase(MergeShuffle)
+{
+    const int size = 100000;
+    ThreadPool pool(4);
+    Array<int> first(size), second(size);
+    for (int i = 0; i < size; ++i) first[i] = second[i] = i;
+
+    MergeShuffler(77, pool)(first);
+    MergeShuffler(77, pool)(second);
+
+    Array<bool> seen(size);
+    for (int i = 0; i < size; ++i) seen[i] = false;
+    int fixed = 0;
+    for (int i = 0; i < size; ++i) {
+        kwr_test(first[i] == second[i]);
+        seen[first[i]] = true;
+        fixed += first[i] == i;
+    }
+    for (int i = 0; i < size; ++i) kwr_test(seen[i]);
+    kwr_test(fixed < 10);
+}
+
+kwr_TestCase(AliasSampling)
+{
+    const double weights[5] = { 1, 0, 2, 3, 4 };
+    AliasSampler sampler(weights, 5);
+    XorShift0 prng(31);
+
+    int counts[5] {};
+    for (int n = 0; n < 100000; ++n)
+        ++counts[sampler(prng)];
+
+    uint32_t batch[100000];
+    sampler.fill(prng, batch, 100000);
+    for (uint32_t k : batch)
+        ++counts[k];
+
+    kwr_test(counts[1] == 0);
+    for (int k = 0; k < 5; ++k) {
+        double expected = 200000 * weights[k] / 10;
+        kwr_test(counts[k] > expected * 0.97 - 1 && counts[k] < expected * 1.03 + 1);
+    }
+
+    // Weights must be finite, not negative, and not all zero.
+    const double bad[4][2] = { { 2, -1 }, { 1, NAN }, { 1, INFINITY }, { 0, 0 } };
+    for (const double* weights : bad) {
+        bool rejected = false;
+        try { AliasSampler(weights, 2); }
+        catch (Defect&) { rejected = true; }
+        kwr_test(rejected);
+    }
+}
+
+kwr_TestCase(ZigguratTables)
+{
+    // The constexpr tables agree with the same recurrence run on <cmath>.
+    const ziggurat::Tables& t = ziggurat::normal;
+    double dn = 3.442619855899, tn = dn, vn = 9.91256303526217e-3;
+    for (int i = 126; i >= 1; --i) {
+        dn = std::sqrt(-2 * std::log(vn / dn + std::exp(-0.5 * dn * dn)));
+        kwr_test(std::fabs(t.w[i] * 2147483648.0 - dn) < 1e-12 * dn);
+        kwr_test(std::fabs(t.f[i] - std::exp(-0.5 * dn * dn)) < 1e-13);
+        uint32_t k = (dn / tn) * 2147483648.0;
+        kwr_test(t.k[i+1] + 1 >= k && t.k[i+1] <= k + 1);
+        tn = dn;
+    }
+}
+
+kwr_TestCase(ZigguratMoments)
+{
+    const int n = 400000;
+    XorShiftN<13,17,5,8> prng(11);
+    Array<double> values(n);
+
+    RandomNormal normal(2.0, 3.0);
+    normal.fill(prng, &values[0], n);
+    double sum = 0, sum2 = 0;
+    for (int k = 0; k < n; ++k) {
+        sum += values[k];
+        sum2 += values[k] * values[k];
+    }
+    double mean = sum / n, variance = sum2 / n - mean * mean;
+    kwr_test(std::fabs(mean - 2.0) < 0.03);
+    kwr_test(std::fabs(variance - 9.0) < 0.1);
+
+    RandomExponential exponential(0.5);
+    sum = 0;
+    int tail = 0;
+    for (int k = 0; k < n; ++k) {
+        double x = exponential(prng);
+        kwr_test(x >= 0);
+        sum += x;
+        tail += x > 2.0 * 7.697117470131487;
+    }
+    kwr_test(std::fabs(sum / n - 2.0) < 0.02);
+    // Values beyond the base layer come from the tail path: about n*e^-7.7.
+    kwr_test(tail > 100 && tail < 280);
+}
+
+kwr_TestCase(FloydSubset)
+{
+    XorShift0 prng(5);
+    RandomSubset subset(3);
+    uint32_t picked[3];
+    int counts[10] = {};
+
+    for (int trial = 0; trial < 30000; ++trial) {
+        subset(prng, 10, picked, 3);
+        kwr_test(picked[0] != picked[1] && picked[0] != picked[2] && picked[1] != picked[2]);
+        for (uint32_t k : picked) {
+            kwr_test(k < 10);
+            ++counts[k];
+        }
+    }
+    for (int k = 0; k < 10; ++k)
+        kwr_test(counts[k] > 8700 && counts[k] < 9300);
+
+    // A handful from a huge range, and every index when k == n.
+    subset(prng, 100000000, picked, 3);
+    kwr_test(picked[0] < 100000000 && picked[0] != picked[1]);
+    subset(prng, 3, Span<uint32_t>{ 3, picked });
+    kwr_test(picked[0] + picked[1] + picked[2] == 3);
+}
+
+kwr_TestCase(ReservoirSampling)
+{
+    XorShift0 prng(9);
+    int kept[10];
+    ReservoirSampler<int> sampler(Span<int>{ 10, kept });
+    int counts[100] = {};
+
+    for (int trial = 0; trial < 20000; ++trial) {
+        CountingSequence items(100);
+        kwr_test(sampler(prng, items) == 10);
+        for (int k : kept) ++counts[k];
+    }
+    for (int k = 0; k < 100; ++k)
+        kwr_test(counts[k] > 1800 && counts[k] < 2200);
+
+    CountingSequence few(4);
+    kwr_test(sampler(prng, few) == 4);
+    kwr_test(kept[0] == 0 && kept[3] == 3);
+}
+
+// A generator restored from a checkpoint, through bytes and into a
+// generator seeded differently, continues the exact stream.
+template <typename PRNG>
+bool checkpointResumes(uint32_t seed)
+{
+    PRNG original(seed), restored(seed + 1);
+    for (int i = 0; i < 1001; ++i) original();
+
+    uint8_t bytes[sizeof(typename PRNG::State)];
+    saveState(original, Span<uint8_t>{ sizeof bytes, bytes });
+    loadState(restored, Span<const uint8_t>{ sizeof bytes, bytes });
+
+    if (restored.get() != original.get()) return false;
+    for (int i = 0; i < 5000; ++i)
+        if (restored() != original()) return false;
+    return true;
+}
+
+kwr_TestCase(PrngCheckpoint)
+{
+    typedef XorShiftN<13,17,5,8> XorShift0x8;
+    kwr_test(checkpointResumes<XorShift0>(42));
+    kwr_test(checkpointResumes<XorShift0x8>(42));
+    kwr_test(checkpointResumes<MINSTD>(42));
+    kwr_test(checkpointResumes<CMWC8>(42));
+    kwr_test(checkpointResumes<ComplimentaryMultiplyWithCarry>(42));
+    kwr_test(checkpointResumes<Philox>(42));
+    kwr_test(checkpointResumes<Xoshiro256>(42));
+    kwr_test(checkpointResumes<Xoroshiro128Plus>(42));
+    kwr_test(checkpointResumes<Pcg32>(42));
+}
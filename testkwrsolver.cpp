@@ -0,0 +1,158 @@
+#include "kwrlib.h"
+#include "kwrmaze.h"
+#include "kwrsolver.h"
+
+using namespace kwr;
+
+// A path that goes from first to last through open passages.
+template <typename Grid>
+bool isPath(const Grid& maze, Span<const int> path, int first, int last)
+{
+    if (path.size == 0 || path.data[0] != first || path.data[path.size-1] != last) return false;
+    for (int k = 1; k < path.size; ++k) {
+        bool joined = false;
+        for (int d = 0; d < 4; ++d)
+            joined |= maze.neighbor(path.data[k-1], d) == path.data[k] && maze.open(path.data[k-1], d);
+        if (!joined) return false;
+    }
+    return true;
+}
+
+kwr_TestCase(SolverDistances)
+{
+    CompactMazeGrid maze(20, 30);
+    KruskalMaze(maze, 4);
+    MazeSolver solver(maze);
+
+    int farthest = solver.fill(37);
+    kwr_test(solver.distance(37) == 0);
+    bool reached = true, farthest_is_max = true;
+    for (int i = 0; i < maze.size(); ++i) {
+        reached &= solver.distance(i) >= 0;
+        farthest_is_max &= solver.distance(i) <= solver.distance(farthest);
+    }
+    kwr_test(reached && farthest_is_max);
+
+    Span<const int> path = solver.path(555);
+    kwr_test(path.size == solver.distance(555) + 1);
+    kwr_test(isPath(maze, path, 37, 555));
+
+    Span<const int> longest = solver.longestPath();
+    int length = longest.size, first = longest.data[0], last = longest.data[length-1];
+    kwr_test(isPath(maze, longest, first, last));
+    bool longer = false;
+    for (int end : { first, last }) {
+        solver.fill(end);
+        for (int i = 0; i < maze.size(); ++i) longer |= solver.distance(i) > length - 1;
+    }
+    kwr_test(solver.distance(first) == length - 1 && !longer);
+    kwr_test(isPath(maze, solver.solve(first, last), first, last));
+
+    CompactMazeGrid corridor(1, 12), single(1, 1);
+    for (int i = 0; i < 11; ++i) corridor.link(i, East);
+    MazeSolver corridor_solver(corridor), single_solver(single);
+    kwr_test(corridor_solver.longestPath().size == 12 && single_solver.longestPath().size == 1);
+}
+
+kwr_TestCase(SolverBidirectional)
+{
+    MazeGrid maze(25, 17);
+    WilsonMaze(maze, 8);
+    MazeSolver solver(maze);
+
+    bool shortest = true;
+    for (int k = 0; k < 50; ++k) {
+        int source = k * 97 % maze.size(), target = k * 211 % maze.size();
+        Span<const int> path = solver.solve(source, target);
+        shortest &= isPath(maze, path, source, target);
+        solver.fill(source);
+        shortest &= path.size == solver.distance(target) + 1;
+    }
+    kwr_test(shortest);
+    kwr_test(solver.solve(12, 12).size == 1);
+
+    // With every wall open there are many shortest paths, all Manhattan.
+    CompactMazeGrid open(9, 13);
+    for (int i = 0; i < open.size(); ++i) {
+        open.link(i, East);
+        open.link(i, South);
+    }
+    MazeSolver open_solver(open);
+    Span<const int> path = open_solver.solve(0, open.size() - 1);
+    kwr_test(isPath(open, path, 0, open.size() - 1) && path.size == 9 + 13 - 1);
+    kwr_test(open_solver.solve(4 * 13, 4 * 13 + 12).size == 13);
+
+    // With no passages nothing is reachable.
+    CompactMazeGrid walls(4, 4);
+    MazeSolver walled(walls);
+    kwr_test(walled.solve(0, 15).size == 0);
+    kwr_test(walled.fill(5) == 5 && walled.distance(6) == -1 && walled.path(6).size == 0);
+}
+
+// Cheapest costs from source by relaxing every passage until nothing
+// changes, to check the heap-based searches against.
+template <typename Grid>
+void relaxedCosts(const Grid& maze, const Array<uint32_t>& cost, int source, Array<uint32_t>& best)
+{
+    std::fill(&best[0], &best[0] + best.size(), UINT32_MAX);
+    best[source] = 0;
+    for (bool changed = true; changed; ) {
+        changed = false;
+        for (int i = 0; i < maze.size(); ++i) {
+            for (int d = 0; d < 4; ++d) {
+                int next = maze.neighbor(i, d);
+                if (best[i] == UINT32_MAX || next < 0 || !maze.open(i, d)) continue;
+                if (best[i] + cost[next] < best[next]) {
+                    best[next] = best[i] + cost[next];
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+uint32_t pathSum(const Array<uint32_t>& cost, Span<const int> path)
+{
+    uint32_t sum = 0;
+    for (int k = 1; k < path.size; ++k) sum += cost[path.data[k]];
+    return sum;
+}
+
+kwr_TestCase(SolverWeighted)
+{
+    // Mostly open, so there are many paths to choose between.
+    CompactMazeGrid maze(16, 21);
+    KruskalMaze(maze, 12);
+    Pcg32 prng(99);
+    for (int i = 0; i < maze.size(); ++i) {
+        if (prng() % 3) maze.link(i, East);
+        if (prng() % 3) maze.link(i, South);
+    }
+    Array<uint32_t> cost(maze.size());
+    for (int i = 0; i < maze.size(); ++i) cost[i] = 1 + prng() % 9;
+
+    MazeSolver solver(maze);
+    solver.weigh({ cost.size(), &cost[0] });
+    Array<uint32_t> best(maze.size());
+    bool cheapest = true;
+    for (int source : { 0, 100, 250 }) {
+        relaxedCosts(maze, cost, source, best);
+        for (int target = 0; target < maze.size(); target += 7) {
+            Span<const int> path = solver.dijkstra(source, target);
+            cheapest &= isPath(maze, path, source, target) && solver.pathCost() == best[target];
+            cheapest &= pathSum(cost, path) == best[target];
+            path = solver.astar(source, target);
+            cheapest &= isPath(maze, path, source, target) && solver.pathCost() == best[target];
+            cheapest &= pathSum(cost, path) == best[target];
+        }
+    }
+    kwr_test(cheapest);
+    kwr_test(solver.astar(33, 33).size == 1 && solver.pathCost() == 0);
+
+    CompactMazeGrid walls(3, 3);
+    Array<uint32_t> ones(9);
+    std::fill(&ones[0], &ones[0] + 9, 1);
+    MazeSolver walled(walls);
+    walled.weigh({ ones.size(), &ones[0] });
+    kwr_test(walled.dijkstra(0, 8).size == 0 && walled.astar(0, 8).size == 0);
+}